@@ -71,11 +71,16 @@ enum SearchMatchType
 class FrameGraphicsItem : public QGraphicsRectItem
 {
 public:
-    FrameGraphicsItem(const qint64 cost, Data::Costs::Unit unit, const Data::Symbol& symbol, FrameGraphicsItem* parent = nullptr);
+    FrameGraphicsItem(const qint64 cost, Data::Costs::Unit unit, const Data::Symbol& symbol,
+                      Data::SymbolId symbolId = Data::INVALID_SYMBOL_ID, FrameGraphicsItem* parent = nullptr);
 
     qint64 cost() const;
     void setCost(qint64 cost);
     Data::Symbol symbol() const;
+    // compares the symbol ids if available, which is much cheaper than comparing the strings
+    bool isSymbol(Data::SymbolId symbolId, const Data::Symbol& symbol) const;
+    // the child item for the given symbol, looked up by id if available
+    FrameGraphicsItem* childForSymbol(Data::SymbolId symbolId, const Data::Symbol& symbol) const;
 
     void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
 
@@ -89,22 +94,31 @@ protected:
 private:
     qint64 m_cost;
     Data::Symbol m_symbol;
+    Data::SymbolId m_symbolId;
     bool m_isHovered;
     SearchMatchType m_searchMatch = NoSearch;
     Data::Costs::Unit m_unit;
+    // frames can have thousands of children, don't scan them linearly
+    QHash<Data::SymbolId, FrameGraphicsItem*> m_childrenBySymbolId;
 };
 
 Q_DECLARE_METATYPE(FrameGraphicsItem*)
 
-FrameGraphicsItem::FrameGraphicsItem(const qint64 cost, Data::Costs::Unit unit, const Data::Symbol& symbol, FrameGraphicsItem* parent)
+FrameGraphicsItem::FrameGraphicsItem(const qint64 cost, Data::Costs::Unit unit, const Data::Symbol& symbol,
+                                     Data::SymbolId symbolId, FrameGraphicsItem* parent)
     : QGraphicsRectItem(parent)
     , m_cost(cost)
     , m_symbol(symbol)
+    , m_symbolId(symbolId)
     , m_isHovered(false)
     , m_unit(unit)
 {
     setFlag(QGraphicsItem::ItemIsSelectable);
     setAcceptHoverEvents(true);
+
+    if (parent && symbolId != Data::INVALID_SYMBOL_ID && !parent->m_childrenBySymbolId.contains(symbolId)) {
+        parent->m_childrenBySymbolId.insert(symbolId, this);
+    }
 }
 
 qint64 FrameGraphicsItem::cost() const
@@ -122,6 +136,29 @@ Data::Symbol FrameGraphicsItem::symbol() const
     return m_symbol;
 }
 
+bool FrameGraphicsItem::isSymbol(Data::SymbolId symbolId, const Data::Symbol& symbol) const
+{
+    if (symbolId != Data::INVALID_SYMBOL_ID) {
+        return symbolId == m_symbolId;
+    }
+    return m_symbolId == Data::INVALID_SYMBOL_ID && symbol == m_symbol;
+}
+
+FrameGraphicsItem* FrameGraphicsItem::childForSymbol(Data::SymbolId symbolId, const Data::Symbol& symbol) const
+{
+    if (symbolId != Data::INVALID_SYMBOL_ID) {
+        return m_childrenBySymbolId.value(symbolId, nullptr);
+    }
+
+    foreach (auto item_, childItems()) {
+        auto item = static_cast<FrameGraphicsItem*>(item_);
+        if (item->isSymbol(symbolId, symbol)) {
+            return item;
+        }
+    }
+    return nullptr;
+}
+
 void FrameGraphicsItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* /*widget*/)
 {
     if (isSelected() || m_isHovered || m_searchMatch == DirectMatch) {
@@ -302,17 +339,6 @@ void layoutItems(FrameGraphicsItem* parent)
     }
 }
 
-FrameGraphicsItem* findItemBySymbol(const QList<QGraphicsItem*>& items, const Data::Symbol& symbol)
-{
-    foreach (auto item_, items) {
-        auto item = static_cast<FrameGraphicsItem*>(item_);
-        if (item->symbol() == symbol) {
-            return item;
-        }
-    }
-    return nullptr;
-}
-
 /**
  * Convert the top-down graph into a tree of FrameGraphicsItem.
  */
@@ -321,15 +347,15 @@ void toGraphicsItems(const Data::Costs& costs, int type, const QVector<Tree>& da
                      const double costThreshold, bool collapseRecursion)
 {
     foreach (const auto& row, data) {
-        if (collapseRecursion && !row.symbol.symbol.isEmpty() && row.symbol == parent->symbol()) {
+        if (collapseRecursion && !row.symbol.symbol.isEmpty() && parent->isSymbol(row.symbolId, row.symbol)) {
             if (costs.cost(type, row.id) > costThreshold) {
                 toGraphicsItems(costs, type, row.children, parent, costThreshold, collapseRecursion);
             }
             continue;
         }
-        auto item = findItemBySymbol(parent->childItems(), row.symbol);
+        auto item = parent->childForSymbol(row.symbolId, row.symbol);
         if (!item) {
-            item = new FrameGraphicsItem(costs.cost(type, row.id), costs.unit(type), row.symbol, parent);
+            item = new FrameGraphicsItem(costs.cost(type, row.id), costs.unit(type), row.symbol, row.symbolId, parent);
             item->setPen(parent->pen());
             item->setBrush(brush(row.symbol, BrushType::Hot));
         } else {
@@ -595,7 +621,7 @@ bool FlameGraph::eventFilter(QObject* object, QEvent* event)
     return ret;
 }
 
-void FlameGraph::setTopDownData(const Data::TopDownResults& topDownData)
+void FlameGraph::setTopDownData(const Data::Snapshot<Data::TopDownResults>& topDownData)
 {
     m_topDownData = topDownData;
 
@@ -606,12 +632,12 @@ void FlameGraph::setTopDownData(const Data::TopDownResults& topDownData)
     }
 }
 
-void FlameGraph::setBottomUpData(const Data::BottomUpResults& bottomUpData)
+void FlameGraph::setBottomUpData(const Data::Snapshot<Data::BottomUpResults>& bottomUpData)
 {
     m_bottomUpData = bottomUpData;
 
     disconnect(m_costSource, nullptr, this, nullptr);
-    ResultsUtil::fillEventSourceComboBox(m_costSource, bottomUpData.costs,
+    ResultsUtil::fillEventSourceComboBox(m_costSource, bottomUpData->costs,
                                          ki18n("Show a flame graph over the aggregated %1 sample costs."));
     connect(m_costSource, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
             &FlameGraph::showData);
@@ -636,7 +662,7 @@ QImage FlameGraph::toImage() const
 
 void FlameGraph::saveSvg(const QString &fileName) const
 {
-    if (!m_rootItem)
+    if (!m_rootItem || !m_bottomUpData)
         return;
 
     const auto sceneRect = m_scene->sceneRect();
@@ -649,7 +675,7 @@ void FlameGraph::saveSvg(const QString &fileName) const
         generator.setTitle(tr("Bottom Up FlameGraph"));
     else
         generator.setTitle(tr("Top Down FlameGraph"));
-    const auto costType = m_bottomUpData.costs.typeName(m_costSource->currentData().value<int>());
+    const auto costType = m_bottomUpData->costs.typeName(m_costSource->currentData().value<int>());
     generator.setDescription(tr("Cost type: %1, cost threshold: %2\n%3")
                                 .arg(costType, QString::number(m_costThreshold),
                                      m_displayLabel->text()));
@@ -669,8 +695,8 @@ void FlameGraph::saveSvg(const QString &fileName) const
 void FlameGraph::showData()
 {
     auto showBottomUpData = m_showBottomUpData;
-    if ((showBottomUpData && !m_bottomUpData.costs.numTypes())
-        || (!showBottomUpData && !m_topDownData.selfCosts.numTypes())) {
+    if ((showBottomUpData && (!m_bottomUpData || !m_bottomUpData->costs.numTypes()))
+        || (!showBottomUpData && (!m_topDownData || !m_topDownData->selfCosts.numTypes()))) {
         // gammaray asks for the data to be shown too early, ensure we don't crash then
         return;
     }
@@ -679,18 +705,20 @@ void FlameGraph::showData()
 
     m_buildingScene = true;
     using namespace ThreadWeaver;
-    auto bottomUpData = m_bottomUpData;
-    auto topDownData = m_topDownData;
+    // the job only shares the snapshot it needs, the results are never copied
+    auto bottomUpData = showBottomUpData ? m_bottomUpData : Data::Snapshot<Data::BottomUpResults>();
+    auto topDownData = showBottomUpData ? Data::Snapshot<Data::TopDownResults>() : m_topDownData;
     bool collapseRecursion = m_collapseRecursion;
     auto type = m_costSource->currentData().value<int>();
     auto threshold = m_costThreshold;
     stream() << make_job([showBottomUpData, bottomUpData, topDownData, type, threshold, collapseRecursion, this]() {
         FrameGraphicsItem* parsedData = nullptr;
         if (showBottomUpData) {
-            parsedData = parseData(bottomUpData.costs, type, bottomUpData.root.children, threshold, collapseRecursion);
+            parsedData =
+                parseData(bottomUpData->costs, type, bottomUpData->root.children, threshold, collapseRecursion);
         } else {
             parsedData =
-                parseData(topDownData.inclusiveCosts, type, topDownData.root.children, threshold, collapseRecursion);
+                parseData(topDownData->inclusiveCosts, type, topDownData->root.children, threshold, collapseRecursion);
         }
         QMetaObject::invokeMethod(this, "setData", Qt::QueuedConnection, Q_ARG(FrameGraphicsItem*, parsedData));
     });
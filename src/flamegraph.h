@@ -51,8 +51,8 @@ public:
     ~FlameGraph();
 
     void setFilterStack(FilterAndZoomStack *filterStack);
-    void setTopDownData(const Data::TopDownResults& topDownData);
-    void setBottomUpData(const Data::BottomUpResults& bottomUpData);
+    void setTopDownData(const Data::Snapshot<Data::TopDownResults>& topDownData);
+    void setBottomUpData(const Data::Snapshot<Data::BottomUpResults>& bottomUpData);
     void clear();
 
     QImage toImage() const;
@@ -80,8 +80,8 @@ private:
     void selectItem(FrameGraphicsItem* item);
     void updateNavigationActions();
 
-    Data::TopDownResults m_topDownData;
-    Data::BottomUpResults m_bottomUpData;
+    Data::Snapshot<Data::TopDownResults> m_topDownData;
+    Data::Snapshot<Data::BottomUpResults> m_bottomUpData;
 
     FilterAndZoomStack* m_filterStack = nullptr;
     QComboBox* m_costSource;
@@ -70,6 +70,10 @@ int main(int argc, char** argv)
     qRegisterMetaType<Data::TopDownResults>();
     qRegisterMetaType<Data::CallerCalleeResults>();
     qRegisterMetaType<Data::EventResults>();
+    qRegisterMetaType<Data::Snapshot<Data::BottomUpResults>>("Data::Snapshot<Data::BottomUpResults>");
+    qRegisterMetaType<Data::Snapshot<Data::TopDownResults>>("Data::Snapshot<Data::TopDownResults>");
+    qRegisterMetaType<Data::Snapshot<Data::CallerCalleeResults>>("Data::Snapshot<Data::CallerCalleeResults>");
+    qRegisterMetaType<Data::Snapshot<Data::EventResults>>("Data::Snapshot<Data::EventResults>");
 
 #if APPIMAGE_BUILD
     QIcon::setThemeSearchPaths({app.applicationDirPath() + QLatin1String("/../share/icons/")});
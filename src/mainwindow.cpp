@@ -132,9 +132,16 @@ MainWindow::MainWindow(QWidget* parent)
     connect(m_recordPage, &RecordPage::openFile, this,
             static_cast<void (MainWindow::*)(const QString&)>(&MainWindow::openFile));
 
+    // show what got parsed so far for big files, the results pages get updated in place until parsing finished
+    m_parser->setPartialResultsInterval(1000);
+    connect(m_parser, &PerfParser::partialResultsAvailable, this,
+            [this]() { m_pageStack->setCurrentWidget(m_resultsPage); });
     connect(m_parser, &PerfParser::parsingFinished, this, [this]() { m_pageStack->setCurrentWidget(m_resultsPage); });
-    connect(m_parser, &PerfParser::parsingFailed, this,
-            [this](const QString& errorMessage) { emit openFileError(errorMessage); });
+    connect(m_parser, &PerfParser::parsingFailed, this, [this](const QString& errorMessage) {
+        // we may already show partial results, go back to report the error
+        m_pageStack->setCurrentWidget(m_startPage);
+        emit openFileError(errorMessage);
+    });
 
     auto* recordDataAction = new QAction(this);
     recordDataAction->setText(tr("&Record Data"));
@@ -143,6 +150,29 @@ MainWindow::MainWindow(QWidget* parent)
     ui->fileMenu->addAction(recordDataAction);
     connect(recordDataAction, &QAction::triggered, this, &MainWindow::onRecordButtonClicked);
 
+    // when analyzing live, the recording continues in the background while we show the results
+    auto* stopLiveRecordingAction = new QAction(this);
+    stopLiveRecordingAction->setText(tr("Stop &Live Recording"));
+    stopLiveRecordingAction->setIcon(QIcon::fromTheme(QStringLiteral("media-playback-stop")));
+    stopLiveRecordingAction->setEnabled(false);
+    ui->fileMenu->addAction(stopLiveRecordingAction);
+    connect(stopLiveRecordingAction, &QAction::triggered, m_recordPage, &RecordPage::stopRecording);
+
+    connect(m_recordPage, &RecordPage::liveRecordingStarted, this, [this, stopLiveRecordingAction]() {
+        // only keep the events of the last 30s around, to bound the memory usage for long running recordings
+        const quint64 liveWindow = 30ull * 1000000000ull;
+        setWindowTitle(tr("Live - Hotspot"));
+        m_resultsPage->selectSummaryTab();
+        m_resultsPage->clear();
+        m_parser->startParseLive(liveWindow, m_sysroot, m_kallsyms, m_debugPaths, m_extraLibPaths, m_appPath, m_arch);
+        stopLiveRecordingAction->setEnabled(true);
+    });
+    connect(m_recordPage, &RecordPage::liveRecordingData, m_parser, &PerfParser::addLiveData);
+    connect(m_recordPage, &RecordPage::liveRecordingFinished, this, [this, stopLiveRecordingAction]() {
+        stopLiveRecordingAction->setEnabled(false);
+        m_parser->finishLiveData();
+    });
+
     connect(m_resultsPage, &ResultsPage::navigateToCode, this, &MainWindow::navigateToCode);
     ui->fileMenu->addAction(KStandardAction::open(this, SLOT(onOpenFileButtonClicked()), this));
     m_recentFilesAction = KStandardAction::openRecent(this, SLOT(openFile(QUrl)), this);
@@ -32,6 +32,7 @@
 
 CallerCalleeModel::CallerCalleeModel(QObject* parent)
     : HashModel(parent)
+    , m_results(Data::makeSnapshot(Data::CallerCalleeResults()))
 {
     connect(Settings::instance(), &Settings::prettifySymbolsChanged, this, [this]() {
         if (rowCount() == 0) {
@@ -43,10 +44,15 @@ CallerCalleeModel::CallerCalleeModel(QObject* parent)
 
 CallerCalleeModel::~CallerCalleeModel() = default;
 
-void CallerCalleeModel::setResults(const Data::CallerCalleeResults& results)
+void CallerCalleeModel::setResults(const Data::Snapshot<Data::CallerCalleeResults>& results)
 {
     m_results = results;
-    setRows(results.entries);
+    setRows(results->entries);
+}
+
+void CallerCalleeModel::setResults(const Data::CallerCalleeResults& results)
+{
+    setResults(Data::makeSnapshot(results));
 }
 
 QVariant CallerCalleeModel::headerCell(int column, int role) const
@@ -61,11 +67,11 @@ QVariant CallerCalleeModel::headerCell(int column, int role) const
             return tr("Binary");
         }
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.selfCosts.numTypes()) {
-            return tr("%1 (self)").arg(m_results.selfCosts.typeName(column));
+        if (column < m_results->selfCosts.numTypes()) {
+            return tr("%1 (self)").arg(m_results->selfCosts.typeName(column));
         }
-        column -= m_results.selfCosts.numTypes();
-        return tr("%1 (incl.)").arg(m_results.inclusiveCosts.typeName(column));
+        column -= m_results->selfCosts.numTypes();
+        return tr("%1 (incl.)").arg(m_results->inclusiveCosts.typeName(column));
     } else if (role == Qt::ToolTipRole) {
         switch (column) {
         case Symbol:
@@ -76,7 +82,7 @@ QVariant CallerCalleeModel::headerCell(int column, int role) const
         }
 
         column -= 2;
-        if (column < m_results.selfCosts.numTypes()) {
+        if (column < m_results->selfCosts.numTypes()) {
             return tr("The aggregated sample costs directly attributed to this symbol.");
         }
         return tr("The aggregated sample costs attributed to this symbol, both directly and indirectly. This includes "
@@ -94,24 +100,24 @@ QVariant CallerCalleeModel::cell(int column, int role, const Data::Symbol& symbo
     } else if (role == SortRole) {
         switch (column) {
         case Symbol:
-            return Util::formatSymbol(symbol.prettySymbol);
+            return Util::formatSymbol(symbol.prettySymbol());
         case Binary:
             return symbol.binary;
         }
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.selfCosts.numTypes()) {
-            return m_results.selfCosts.cost(column, entry.id);
+        if (column < m_results->selfCosts.numTypes()) {
+            return m_results->selfCosts.cost(column, entry.id);
         }
-        column -= m_results.selfCosts.numTypes();
-        return m_results.inclusiveCosts.cost(column, entry.id);
+        column -= m_results->selfCosts.numTypes();
+        return m_results->inclusiveCosts.cost(column, entry.id);
     } else if (role == TotalCostRole && column >= NUM_BASE_COLUMNS) {
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.selfCosts.numTypes()) {
-            return m_results.selfCosts.totalCost(column);
+        if (column < m_results->selfCosts.numTypes()) {
+            return m_results->selfCosts.totalCost(column);
         }
 
-        column -= m_results.selfCosts.numTypes();
-        return m_results.inclusiveCosts.totalCost(column);
+        column -= m_results->selfCosts.numTypes();
+        return m_results->inclusiveCosts.totalCost(column);
     } else if (role == FilterRole) {
         // TODO: optimize this
         return QString(Util::formatSymbol(symbol, false) + symbol.binary);
@@ -123,13 +129,13 @@ QVariant CallerCalleeModel::cell(int column, int role, const Data::Symbol& symbo
             return symbol.binary;
         }
         column -= 2;
-        if (column < m_results.selfCosts.numTypes()) {
-            return Util::formatCostRelative(m_results.selfCosts.cost(column, entry.id),
-                                            m_results.selfCosts.totalCost(column), true);
+        if (column < m_results->selfCosts.numTypes()) {
+            return Util::formatCostRelative(m_results->selfCosts.cost(column, entry.id),
+                                            m_results->selfCosts.totalCost(column), true);
         }
-        column -= m_results.selfCosts.numTypes();
-        return Util::formatCostRelative(m_results.inclusiveCosts.cost(column, entry.id),
-                                        m_results.inclusiveCosts.totalCost(column), true);
+        column -= m_results->selfCosts.numTypes();
+        return Util::formatCostRelative(m_results->inclusiveCosts.cost(column, entry.id),
+                                        m_results->inclusiveCosts.totalCost(column), true);
     } else if (role == CalleesRole) {
         return QVariant::fromValue(entry.callees);
     } else if (role == CallersRole) {
@@ -137,11 +143,11 @@ QVariant CallerCalleeModel::cell(int column, int role, const Data::Symbol& symbo
     } else if (role == SourceMapRole) {
         return QVariant::fromValue(entry.sourceMap);
     } else if (role == SelfCostsRole) {
-        return QVariant::fromValue(m_results.selfCosts);
+        return QVariant::fromValue(m_results->selfCosts);
     } else if (role == InclusiveCostsRole) {
-        return QVariant::fromValue(m_results.inclusiveCosts);
+        return QVariant::fromValue(m_results->inclusiveCosts);
     } else if (role == Qt::ToolTipRole) {
-        return Util::formatTooltip(entry.id, symbol, m_results.selfCosts, m_results.inclusiveCosts);
+        return Util::formatTooltip(entry.id, symbol, m_results->selfCosts, m_results->inclusiveCosts);
     }
 
     return {};
@@ -185,5 +191,5 @@ SourceMapModel::~SourceMapModel() = default;
 
 int CallerCalleeModel::numColumns() const
 {
-    return NUM_BASE_COLUMNS + m_results.inclusiveCosts.numTypes() + m_results.selfCosts.numTypes();
+    return NUM_BASE_COLUMNS + m_results->inclusiveCosts.numTypes() + m_results->selfCosts.numTypes();
 }
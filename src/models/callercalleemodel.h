@@ -41,6 +41,7 @@ public:
     explicit CallerCalleeModel(QObject* parent = nullptr);
     ~CallerCalleeModel();
 
+    void setResults(const Data::Snapshot<Data::CallerCalleeResults>& results);
     void setResults(const Data::CallerCalleeResults& results);
 
     enum Columns
@@ -74,7 +75,7 @@ public:
     QModelIndex indexForSymbol(const Data::Symbol& symbol) const;
 
 private:
-    Data::CallerCalleeResults m_results;
+    Data::Snapshot<Data::CallerCalleeResults> m_results;
 };
 
 template<typename ModelImpl>
@@ -30,41 +30,60 @@
 #include <QDebug>
 #include <QSet>
 
+#include <cmath>
+
 using namespace Data;
 
 namespace {
 
-ItemCost buildTopDownResult(const BottomUp& bottomUpData, const Costs& bottomUpCosts, TopDown* topDownData,
-                            Costs* inclusiveCosts, Costs* selfCosts, quint32* maxId)
-{
-    ItemCost totalCost;
-    totalCost.resize(bottomUpCosts.numTypes(), 0);
-    for (const auto& row : bottomUpData.children) {
-        // recurse and find the cost attributed to children
-        const auto childCost = buildTopDownResult(row, bottomUpCosts, topDownData, inclusiveCosts, selfCosts, maxId);
-        const auto rowCost = bottomUpCosts.itemCost(row.id);
-        const auto diff = rowCost - childCost;
-        if (diff.sum() != 0) {
+// computes the cost of @p row that is not attributed to its children, i.e. where it is (partially) a leaf
+// @p cost must hold the costs of all types, this way we don't allocate anything per row
+void leafCost(const BottomUp& row, const Costs& costs, ItemCost* cost)
+{
+    const auto numTypes = costs.numTypes();
+    auto* leafCost = std::begin(*cost);
+    if (const auto rowCost = costs.row(row.id)) {
+        std::copy_n(rowCost, numTypes, leafCost);
+    } else {
+        std::fill_n(leafCost, numTypes, 0);
+    }
+    for (const auto& child : row.children) {
+        if (const auto childCost = costs.row(child.id)) {
+            Costs::subtractRow(leafCost, childCost, numTypes);
+        }
+    }
+}
+
+// handles the children of @p bottomUpData in [begin, end)
+// @p diff is scratch space for the leaf costs, shared by all rows
+void buildTopDownResult(const BottomUp& bottomUpData, int begin, int end, const Costs& bottomUpCosts,
+                        TopDown* topDownData, Costs* inclusiveCosts, Costs* selfCosts, quint32* maxId,
+                        ItemCost* diff)
+{
+    for (int i = begin; i < end; ++i) {
+        const auto& row = bottomUpData.children[i];
+        buildTopDownResult(row, 0, row.children.size(), bottomUpCosts, topDownData, inclusiveCosts, selfCosts,
+                           maxId, diff);
+        leafCost(row, bottomUpCosts, diff);
+        if (diff->sum() != 0) {
             // this row is (partially) a leaf
             // bubble up the parent chain to build a top-down tree
             auto node = &row;
             auto stack = topDownData;
             while (node) {
-                auto frame = stack->entryForSymbol(node->symbol, maxId);
+                auto frame = stack->entryForSymbol(node->symbolId, node->symbol, maxId);
 
                 // always use the leaf node's cost and propagate that one up the chain
                 // otherwise we'd count the cost of some nodes multiple times
-                inclusiveCosts->add(frame->id, diff);
+                inclusiveCosts->add(frame->id, *diff);
                 if (!node->parent) {
-                    selfCosts->add(frame->id, diff);
+                    selfCosts->add(frame->id, *diff);
                 }
                 stack = frame;
                 node = node->parent;
             }
         }
-        totalCost += rowCost;
     }
-    return totalCost;
 }
 
 void add(ItemCost& lhs, const ItemCost& rhs)
@@ -77,226 +96,533 @@ void add(ItemCost& lhs, const ItemCost& rhs)
     }
 }
 
-ItemCost buildCallerCalleeResult(const BottomUp& data, const Costs& bottomUpCosts, CallerCalleeResults* results)
+/**
+ * Builds the caller/callee data by bubbling up the parent chain of every leaf of a bottom up tree.
+ *
+ * Symbols must only be counted once per stack. Instead of filling sets for every leaf, the
+ * symbols and caller/callee pairs are marked with the number of the leaf that visited them last.
+ * The slots of the symbols and pairs remember where their costs go, so symbols only get hashed when
+ * they are new. Together with the reused scratch buffer, this means no heap allocations happen per leaf.
+ */
+class CallerCalleeBuilder
 {
-    ItemCost totalCost;
-    totalCost.resize(bottomUpCosts.numTypes(), 0);
-    for (const auto& row : data.children) {
-        // recurse to find a leaf
-        const auto childCost = buildCallerCalleeResult(row, bottomUpCosts, results);
-        const auto rowCost = bottomUpCosts.itemCost(row.id);
-        const auto diff = rowCost - childCost;
-        if (diff.sum() != 0) {
-            // this row is (partially) a leaf
+public:
+    CallerCalleeBuilder(const Costs& costs, CallerCalleeResults* results)
+        : m_costs(costs)
+        , m_results(results)
+        , m_diff(qint64(0), costs.numTypes())
+    {
+    }
 
-            // leaf node found, bubble up the parent chain to add cost for all frames
-            // to the caller/callee data. this is done top-down since we must not count
-            // symbols more than once in the caller-callee data
-            QSet<Symbol> recursionGuard;
-            auto node = &row;
+    void build(const BottomUp& data)
+    {
+        build(data, 0, data.children.size());
+    }
 
-            QSet<QPair<Symbol, Symbol>> callerCalleeRecursionGuard;
-            Data::Symbol lastSymbol;
-            Data::CallerCalleeEntry* lastEntry = nullptr;
+    // only handles the children of @p data in [begin, end)
+    void build(const BottomUp& data, int begin, int end)
+    {
+        for (int i = begin; i < end; ++i) {
+            const auto& row = data.children[i];
+            // recurse to find a leaf
+            build(row);
+            leafCost(row, m_costs, &m_diff);
+            if (m_diff.sum() != 0) {
+                // this row is (partially) a leaf
+                addLeaf(row);
+            }
+        }
+    }
 
-            while (node) {
-                const auto& symbol = node->symbol;
-                // aggregate caller-callee data
-                auto& entry = results->entry(symbol);
-
-                if (!recursionGuard.contains(symbol)) {
-                    // only increment inclusive cost once for a given stack
-                    results->inclusiveCosts.add(entry.id, diff);
-                    recursionGuard.insert(symbol);
-                }
-                if (!node->parent) {
-                    // always increment the self cost
-                    results->selfCosts.add(entry.id, diff);
+private:
+    // the slots point into the values of the result hashes. QHash allocates a node per value and doesn't
+    // move them when it grows, so these stay valid as long as no values get removed and the hashes don't
+    // detach, i.e. they must not be shared with a copy of the results while building
+    struct SymbolSlot
+    {
+        CallerCalleeEntry* entry = nullptr;
+        quint32 visited = 0;
+    };
+
+    struct PairSlot
+    {
+        // the callee cost in the entry of the caller and the caller cost in the entry of the callee
+        ItemCost* callee = nullptr;
+        ItemCost* caller = nullptr;
+        quint32 visited = 0;
+    };
+
+    // leaf node found, bubble up the parent chain to add cost for all frames
+    // to the caller/callee data. this is done top-down since we must not count
+    // symbols more than once in the caller-callee data
+    void addLeaf(const BottomUp& row)
+    {
+        nextEpoch();
+
+        const auto numTypes = m_costs.numTypes();
+        auto node = &row;
+        const Symbol* lastSymbol = nullptr;
+        int lastSlot = -1;
+        CallerCalleeEntry* lastEntry = nullptr;
+
+        while (node) {
+            const auto& symbol = node->symbol;
+            const auto slot = symbolSlot(*node);
+            // aggregate caller-callee data
+            auto& entry = *this->entry(slot, symbol);
+
+            if (m_slots[slot].visited != m_epoch) {
+                // only increment inclusive cost once for a given stack
+                m_results->inclusiveCosts.add(entry.id, m_diff);
+                m_slots[slot].visited = m_epoch;
+            }
+            if (!node->parent) {
+                // always increment the self cost
+                m_results->selfCosts.add(entry.id, m_diff);
+            }
+            // add current entry as callee to last entry
+            // and last entry as caller to current entry
+            if (lastEntry) {
+                auto& pair = m_pairSlots[(quint64(quint32(slot)) << 32) | quint32(lastSlot)];
+                if (!pair.callee) {
+                    // the symbols only get hashed the first time we encounter a pair, see SymbolSlot
+                    Q_ASSERT(lastEntry->callees.isDetached() && entry.callers.isDetached());
+                    pair.callee = &lastEntry->callee(symbol, numTypes);
+                    pair.caller = &entry.caller(*lastSymbol, numTypes);
                 }
-                // add current entry as callee to last entry
-                // and last entry as caller to current entry
-                if (lastEntry) {
-                    const auto callerCalleePair = qMakePair(symbol, lastSymbol);
-                    if (!callerCalleeRecursionGuard.contains(callerCalleePair)) {
-                        add(lastEntry->callee(symbol, bottomUpCosts.numTypes()), diff);
-                        add(entry.caller(lastSymbol, bottomUpCosts.numTypes()), diff);
-                        callerCalleeRecursionGuard.insert(callerCalleePair);
-                    }
+                if (pair.visited != m_epoch) {
+                    add(*pair.callee, m_diff);
+                    add(*pair.caller, m_diff);
+                    pair.visited = m_epoch;
                 }
+            }
 
-                node = node->parent;
-                lastSymbol = symbol;
-                lastEntry = &entry;
+            node = node->parent;
+            lastSymbol = &symbol;
+            lastSlot = slot;
+            lastEntry = &entry;
+        }
+    }
+
+    void nextEpoch()
+    {
+        if (++m_epoch == 0) {
+            // wrapped around, forget all marks
+            for (auto& slot : m_slots) {
+                slot.visited = 0;
+            }
+            for (auto& pair : m_pairSlots) {
+                pair.visited = 0;
             }
+            m_epoch = 1;
         }
-        totalCost += rowCost;
     }
-    return totalCost;
-}
 
-static int findSameDepth(const QStringRef& str, int offset, QChar ch, bool returnNext = false)
-{
-    const int size = str.size();
+    // a dense index for the symbol of @p node, interned symbols use their id
+    int symbolSlot(const BottomUp& node)
+    {
+        int slot = 0;
+        if (node.symbolId != INVALID_SYMBOL_ID) {
+            slot = node.symbolId * 2;
+        } else {
+            // e.g. for trees that got built from symbols directly
+            auto it = m_uninternedSlots.find(node.symbol);
+            if (it == m_uninternedSlots.end()) {
+                it = m_uninternedSlots.insert(node.symbol, m_uninternedSlots.size() * 2 + 1);
+            }
+            slot = *it;
+        }
 
-    int depth = 0;
-    for (; offset < size; ++offset) {
-        const auto current = str[offset];
-        if (current == QLatin1Char('<') || current == QLatin1Char('(')) {
-            ++depth;
-        } else if (current == QLatin1Char('>') || current == QLatin1Char(')')) {
-            --depth;
+        if (m_slots.size() <= slot) {
+            m_slots.resize(slot + 1);
         }
+        return slot;
+    }
 
-        if (depth == 0 && current == ch) {
-            return offset + (returnNext ? 1 : 0);
+    CallerCalleeEntry* entry(int slot, const Symbol& symbol)
+    {
+        // remember the entry, see SymbolSlot
+        Q_ASSERT(m_results->entries.isDetached());
+        auto& entry = m_slots[slot].entry;
+        if (!entry) {
+            entry = &m_results->entry(symbol);
         }
+        return entry;
     }
-    return -1;
+
+    const Costs& m_costs;
+    CallerCalleeResults* m_results;
+    ItemCost m_diff;
+    QVector<SymbolSlot> m_slots;
+    QHash<Symbol, int> m_uninternedSlots;
+    QHash<quint64, PairSlot> m_pairSlots;
+    quint32 m_epoch = 0;
+};
+
+// the std templates that get shortened, see Data::prettifySymbol
+enum class StdTemplate
+{
+    None,
+    // basic_string<T, ...> becomes string, wstring or basic_string<T>
+    BasicString,
+    // vector<T, ...> and similar become vector<T>
+    OneParameter,
+    // map<T, U, ...> and similar become map<T, U>
+    TwoParameters,
+    // allocator<T> becomes allocator<...>
+    Allocator
+};
+
+enum class StringType
+{
+    Other,
+    Char,
+    WChar
+};
+
+// an opened '<' or '(' while tokenizing a symbol
+struct Bracket
+{
+    Bracket(StdTemplate kind = StdTemplate::None, int argumentsStart = 0)
+        : kind(kind)
+        , argumentsStart(argumentsStart)
+    {
+    }
+
+    StdTemplate kind;
+    // offset into the prettified output, where the first template argument starts
+    int argumentsStart;
+    // number of ',' seen on the depth of this bracket
+    int numCommas = 0;
+    StringType stringType = StringType::Other;
+};
+
+int numKeptArguments(StdTemplate kind)
+{
+    switch (kind) {
+    case StdTemplate::BasicString:
+    case StdTemplate::OneParameter:
+        return 1;
+    case StdTemplate::TwoParameters:
+        return 2;
+    case StdTemplate::Allocator:
+        return 0;
+    case StdTemplate::None:
+        break;
+    }
+    return std::numeric_limits<int>::max();
 }
 
-template<typename T>
-static int startsWith(const QStringRef& str, const std::initializer_list<T>& prefixes)
+bool matchesAt(const QString& str, int offset, QLatin1String prefix)
 {
-    for (const auto& prefix_ : prefixes) {
-        const auto prefix = QLatin1String(prefix_);
-        if (str.startsWith(prefix)) {
-            return prefix.size();
-        }
+    return str.midRef(offset, prefix.size()) == prefix;
+}
+
+// a "std::" that starts a (nested) type, in contrast to e.g. "mystd::"
+bool isStdNamespace(const QString& str, int offset)
+{
+    if (!matchesAt(str, offset, QLatin1String("std::"))) {
+        return false;
     }
-    return -1;
+    if (offset == 0) {
+        return true;
+    }
+    const auto previous = str[offset - 1];
+    return previous == QLatin1Char('<') || previous == QLatin1Char('(') || previous == QLatin1Char(' ')
+        || previous == QLatin1Char(',');
 }
 
-QString prettifySymbol(const QStringRef& str)
+// returns the length of the libstdc++/libc++ internal namespace at @p offset, or zero
+int internalNamespaceLength(const QString& str, int offset)
 {
-    int pos = 0;
-    do {
-        pos = str.indexOf(QLatin1String("std::"), pos);
-        if (pos == -1) {
-            return str.toString();
-        }
-        pos += 5;
-        if (pos == 5 || str[pos - 6] == QLatin1Char('<') || str[pos - 6] == QLatin1Char(' ')
-            || str[pos - 6] == QLatin1Char('(')) {
-            break;
+    for (const auto ns : {QLatin1String("__cxx11::"), QLatin1String("__1::")}) {
+        if (matchesAt(str, offset, ns)) {
+            return ns.size();
         }
-    } while (true);
+    }
+    return 0;
+}
 
-    auto result = str.left(pos).toString();
-    auto symbol = str.mid(pos);
+// returns the kind of the std template at @p offset, @p length is set to the size of its name including the '<'
+StdTemplate stdTemplateAt(const QString& str, int offset, int* length)
+{
+    struct Name
+    {
+        QLatin1String name;
+        StdTemplate kind;
+    };
+    static const Name names[] = {{QLatin1String("basic_string<"), StdTemplate::BasicString},
+                                 {QLatin1String("vector<"), StdTemplate::OneParameter},
+                                 {QLatin1String("set<"), StdTemplate::OneParameter},
+                                 {QLatin1String("deque<"), StdTemplate::OneParameter},
+                                 {QLatin1String("list<"), StdTemplate::OneParameter},
+                                 {QLatin1String("forward_list<"), StdTemplate::OneParameter},
+                                 {QLatin1String("multiset<"), StdTemplate::OneParameter},
+                                 {QLatin1String("unordered_set<"), StdTemplate::OneParameter},
+                                 {QLatin1String("unordered_multiset<"), StdTemplate::OneParameter},
+                                 {QLatin1String("map<"), StdTemplate::TwoParameters},
+                                 {QLatin1String("multimap<"), StdTemplate::TwoParameters},
+                                 {QLatin1String("unordered_map<"), StdTemplate::TwoParameters},
+                                 {QLatin1String("unordered_multimap<"), StdTemplate::TwoParameters},
+                                 {QLatin1String("allocator<"), StdTemplate::Allocator}};
+    for (const auto& name : names) {
+        if (matchesAt(str, offset, name.name)) {
+            *length = name.name.size();
+            return name.kind;
+        }
+    }
+    return StdTemplate::None;
+}
 
-    int end;
+/**
+ * Shortens the std types in @p symbol in a single pass over it.
+ *
+ * The brackets are tracked on an explicit stack. Once all arguments of a std template that we want
+ * to keep are written, the remaining defaulted ones are skipped up to its closing bracket.
+ * Returns a null string when the brackets are unbalanced and the symbol should be kept as is.
+ */
+QString prettify(const QString& symbol)
+{
+    const int size = symbol.size();
+    QString result;
+    result.reserve(size);
+    QVector<Bracket> brackets;
+    // index of the bracket whose remaining arguments get skipped, or -1
+    int skipped = -1;
 
-    if ((end = startsWith(symbol, {"__cxx11::", "__1::"})) != -1) {
-        // Strip libstdc++/libc++ internal namespace
-        symbol = symbol.mid(end);
-    }
+    auto openBracket = [&](QChar c, StdTemplate kind) {
+        result += c;
+        brackets.append(Bracket(kind, result.size()));
+    };
 
-    const auto oneParameterTemplates = {"vector<",       "set<",      "deque<",         "list<",
-                                        "forward_list<", "multiset<", "unordered_set<", "unordered_multiset<"};
-    const auto twoParametersTemplates = {"map<", "multimap<", "unordered_map<", "unordered_multimap<"};
+    auto closeBracket = [&](QChar c, int* offset) {
+        const auto bracket = brackets.takeLast();
+        if (bracket.kind != StdTemplate::BasicString || bracket.stringType == StringType::Other) {
+            result += c;
+        }
 
-    // Translate basic_string<(char|wchar_t|T), ...> to (string|wstring|basic_string<T>)
-    if ((end = startsWith(symbol, {"basic_string<"})) != -1) {
-        const int comma = findSameDepth(symbol, end, QLatin1Char(','));
-        if (comma != -1) {
-            const auto type = symbol.mid(end, comma - end);
-            if (type == QLatin1String("char")) {
-                result += QLatin1String("string");
-            } else if (type == QLatin1String("wchar_t")) {
-                result += QLatin1String("wstring");
-            } else {
-                result += symbol.left(end);
-                result += type;
-                result += QLatin1Char('>');
-            }
-            end = findSameDepth(symbol, 0, QLatin1Char('>'), true);
-            symbol = symbol.mid(end);
-
-            // Also translate constructor/destructor name
-            const auto constructorDestructor = {"::basic_string(", "::~basic_string("};
-            if ((end = startsWith(symbol, constructorDestructor)) != -1) {
-                result += QLatin1String("::");
-                if (symbol[2] == QLatin1Char('~')) {
-                    result += QLatin1Char('~');
-                }
-                if (type == QLatin1String("wchar_t")) {
+        if (bracket.kind == StdTemplate::BasicString && bracket.numCommas) {
+            // also translate the constructor and destructor names
+            const int next = *offset + 1;
+            const bool isConstructor = matchesAt(symbol, next, QLatin1String("::basic_string("));
+            const bool isDestructor = matchesAt(symbol, next, QLatin1String("::~basic_string("));
+            if (isConstructor || isDestructor) {
+                result += isDestructor ? QLatin1String("::~") : QLatin1String("::");
+                if (bracket.stringType == StringType::WChar) {
                     result += QLatin1Char('w');
-                } else if (type != QLatin1String("char")) {
+                } else if (bracket.stringType == StringType::Other) {
                     result += QLatin1String("basic_");
                 }
-                result += QLatin1String("string(");
-                symbol = symbol.mid(end);
+                result += QLatin1String("string");
+                *offset = next + (isDestructor ? 15 : 14);
+                openBracket(QLatin1Char('('), StdTemplate::None);
             }
         }
-    }
-    // Translates (vector|set|etc.)<T, ...> to (vector|set|etc.)<T>
-    else if ((end = startsWith(symbol, oneParameterTemplates)) != -1) {
-        const int comma = findSameDepth(symbol, end, QLatin1Char(','));
-        if (comma != -1) {
-            result += symbol.left(end);
-            result += prettifySymbol(symbol.mid(end, comma - end));
-            result += QLatin1Char('>');
+    };
 
-            end = findSameDepth(symbol, 0, QLatin1Char('>'), true);
-            symbol = symbol.mid(end);
-        }
-    }
-    // Translates (map|multimap|etc.)<T, U, ...> to (map|multimap|etc.)<T, U>
-    else if ((end = startsWith(symbol, twoParametersTemplates)) != -1) {
-        const int comma1 = findSameDepth(symbol, end, QLatin1Char(','));
-        const int comma2 = findSameDepth(symbol, comma1 + 1, QLatin1Char(','));
-        if (comma1 != -1 && comma2 != -1) {
-            result += symbol.left(end);
-            result += prettifySymbol(symbol.mid(end, comma1 - end));
-            result += prettifySymbol(symbol.mid(comma1, comma2 - comma1));
-            result += QLatin1Char('>');
-
-            end = findSameDepth(symbol, 0, QLatin1Char('>'), true);
-            symbol = symbol.mid(end);
+    for (int i = 0; i < size; ++i) {
+        const auto c = symbol[i];
+        const bool isOpening = c == QLatin1Char('<') || c == QLatin1Char('(');
+        const bool isClosing = c == QLatin1Char('>') || c == QLatin1Char(')');
+
+        if (skipped != -1) {
+            // drop everything up to the closing bracket of the shortened template
+            if (isOpening) {
+                brackets.append(Bracket());
+            } else if (isClosing) {
+                if (brackets.size() - 1 == skipped) {
+                    skipped = -1;
+                    closeBracket(c, &i);
+                } else {
+                    brackets.removeLast();
+                }
+            }
+            continue;
         }
-    }
-    // Translates allocator<T> to allocator<...>
-    else if ((end = startsWith(symbol, {"allocator<"})) != -1) {
-        const int gt = findSameDepth(symbol, 0, QLatin1Char('>'), true);
-        if (gt != -1) {
-            result += symbol.left(end);
-            result += QLatin1String("...>");
 
-            symbol = symbol.mid(gt);
+        if (isStdNamespace(symbol, i)) {
+            result += QLatin1String("std::");
+            i += 5;
+            i += internalNamespaceLength(symbol, i);
+            int length = 0;
+            const auto kind = stdTemplateAt(symbol, i, &length);
+            if (kind != StdTemplate::None) {
+                result += symbol.midRef(i, length - 1);
+                i += length - 1;
+                openBracket(symbol[i], kind);
+                if (kind == StdTemplate::Allocator) {
+                    result += QLatin1String("...");
+                    skipped = brackets.size() - 1;
+                }
+            } else {
+                // continue with the character following the namespace
+                --i;
+            }
+        } else if (isOpening) {
+            openBracket(c, StdTemplate::None);
+        } else if (isClosing && !brackets.isEmpty()) {
+            closeBracket(c, &i);
+        } else if (c == QLatin1Char(',') && !brackets.isEmpty()) {
+            auto& bracket = brackets.last();
+            ++bracket.numCommas;
+            if (bracket.numCommas < numKeptArguments(bracket.kind)) {
+                result += c;
+            } else {
+                if (bracket.kind == StdTemplate::BasicString) {
+                    const auto type = result.midRef(bracket.argumentsStart);
+                    if (type == QLatin1String("char")) {
+                        bracket.stringType = StringType::Char;
+                    } else if (type == QLatin1String("wchar_t")) {
+                        bracket.stringType = StringType::WChar;
+                    }
+                    if (bracket.stringType != StringType::Other) {
+                        // replace the "basic_string<type"
+                        result.chop(result.size() - bracket.argumentsStart + 13);
+                        result += bracket.stringType == StringType::Char ? QLatin1String("string")
+                                                                         : QLatin1String("wstring");
+                    }
+                }
+                skipped = brackets.size() - 1;
+            }
+        } else {
+            result += c;
         }
     }
 
-    if (!symbol.isEmpty()) {
-        result += prettifySymbol(symbol);
+    if (skipped != -1) {
+        return {};
     }
-
     return result;
 }
 }
 
 QString Data::prettifySymbol(const QString& name)
 {
-    const auto result = ::prettifySymbol(QStringRef(&name));
-    return result == name ? name : result;
+    const auto result = prettify(name);
+    return (result.isNull() || result == name) ? name : result;
+}
+
+QString Symbol::prettySymbol() const
+{
+    // interned symbols remember the result, see internPrettySymbol
+    if (!pretty.isNull()) {
+        return pretty;
+    }
+    // symbols without std types are kept as is, which spares us the tokenizer for most of them
+    if (!symbol.contains(QLatin1String("std::"))) {
+        return symbol;
+    }
+    return prettifySymbol(symbol);
+}
+
+void Symbol::internPrettySymbol()
+{
+    pretty = QString();
+    pretty = prettySymbol();
 }
 
 TopDownResults TopDownResults::fromBottomUp(const BottomUpResults& bottomUpData)
+{
+    return fromBottomUp(bottomUpData, 0, bottomUpData.root.children.size());
+}
+
+TopDownResults TopDownResults::fromBottomUp(const BottomUpResults& bottomUpData, int begin, int end)
 {
     TopDownResults results;
     results.selfCosts.initializeCostsFrom(bottomUpData.costs);
     results.inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
-    quint32 maxId = 0;
-    buildTopDownResult(bottomUpData.root, bottomUpData.costs, &results.root, &results.inclusiveCosts,
-                       &results.selfCosts, &maxId);
+    ItemCost diff(qint64(0), bottomUpData.costs.numTypes());
+    buildTopDownResult(bottomUpData.root, begin, end, bottomUpData.costs, &results.root, &results.inclusiveCosts,
+                       &results.selfCosts, &results.maxTopDownId, &diff);
     TopDown::initializeParents(&results.root);
     return results;
 }
 
+void TopDownResults::merge(const TopDownResults& partial)
+{
+    merge(partial, partial.root, &root);
+}
+
+void TopDownResults::merge(const TopDownResults& partial, const TopDown& partialParent, TopDown* parent)
+{
+    for (const auto& child : partialParent.children) {
+        auto row = parent->entryForSymbol(child.symbolId, child.symbol, &maxTopDownId);
+        if (const auto cost = partial.inclusiveCosts.row(child.id)) {
+            inclusiveCosts.add(row->id, cost);
+        }
+        if (const auto cost = partial.selfCosts.row(child.id)) {
+            selfCosts.add(row->id, cost);
+        }
+        merge(partial, child, row);
+    }
+}
+
+void CallerCalleeResults::merge(const CallerCalleeResults& partial)
+{
+    // iterate in the order of the partial ids, not the hash order, to get deterministic ids
+    QVector<CallerCalleeEntryMap::const_iterator> partialEntries(partial.entries.size());
+    for (auto it = partial.entries.begin(), end = partial.entries.end(); it != end; ++it) {
+        partialEntries[it->id] = it;
+    }
+
+    const auto numTypes = partial.inclusiveCosts.numTypes();
+    for (const auto& it : partialEntries) {
+        const auto& partialEntry = it.value();
+        auto& entry = this->entry(it.key());
+
+        if (const auto cost = partial.inclusiveCosts.row(partialEntry.id)) {
+            inclusiveCosts.add(entry.id, cost);
+        }
+        if (const auto cost = partial.selfCosts.row(partialEntry.id)) {
+            selfCosts.add(entry.id, cost);
+        }
+        for (auto caller = partialEntry.callers.begin(); caller != partialEntry.callers.end(); ++caller) {
+            add(entry.caller(caller.key(), numTypes), caller.value());
+        }
+        for (auto callee = partialEntry.callees.begin(); callee != partialEntry.callees.end(); ++callee) {
+            add(entry.callee(callee.key(), numTypes), callee.value());
+        }
+        for (auto source = partialEntry.sourceMap.begin(); source != partialEntry.sourceMap.end(); ++source) {
+            auto& location = entry.source(source.key(), numTypes);
+            add(location.selfCost, source->selfCost);
+            add(location.inclusiveCost, source->inclusiveCost);
+        }
+    }
+}
+
+void BottomUpResults::merge(const FlatBottomUp& partial)
+{
+    for (int type = 0, c = partial.costs.numTypes(); type < c; ++type) {
+        costs.addTotalCost(type, partial.costs.totalCost(type));
+    }
+    merge(partial, 0, &root);
+}
+
+void BottomUpResults::merge(const FlatBottomUp& partial, qint32 partialParent, BottomUp* parent)
+{
+    const auto& nodes = partial.nodes;
+    for (auto child = nodes[partialParent].firstChild; child != -1; child = nodes[child].nextSibling) {
+        const auto symbolId = nodes[child].symbolId;
+        auto row = parent->entryForSymbol(symbolId, symbolTable.value(symbolId), &maxBottomUpId);
+        for (int type = 0, c = partial.costs.numTypes(); type < c; ++type) {
+            costs.add(type, row->id, partial.costs.cost(type, child));
+        }
+        merge(partial, child, row);
+    }
+}
+
 void Data::callerCalleesFromBottomUpData(const BottomUpResults& bottomUpData, CallerCalleeResults* results)
+{
+    callerCalleesFromBottomUpData(bottomUpData, results, 0, bottomUpData.root.children.size());
+}
+
+void Data::callerCalleesFromBottomUpData(const BottomUpResults& bottomUpData, CallerCalleeResults* results,
+                                         int begin, int end)
 {
     results->inclusiveCosts.initializeCostsFrom(bottomUpData.costs);
     results->selfCosts.initializeCostsFrom(bottomUpData.costs);
-    buildCallerCalleeResult(bottomUpData.root, bottomUpData.costs, results);
+    CallerCalleeBuilder builder(bottomUpData.costs, results);
+    builder.build(bottomUpData.root, begin, end);
 }
 
 QDebug Data::operator<<(QDebug stream, const Symbol& symbol)
@@ -334,6 +660,448 @@ QDebug Data::operator<<(QDebug stream, const CostSummary& cost)
     return stream.resetFormat().space();
 }
 
+namespace {
+template<typename Subset, typename Set>
+bool isSubset(const Subset& subset, const Set& set)
+{
+    return std::all_of(subset.begin(), subset.end(),
+                       [&set](const typename Subset::value_type& value) { return set.contains(value); });
+}
+
+template<typename T>
+bool isNarrowed(T value, T baseValue, T invalidValue)
+{
+    return baseValue == invalidValue || value == baseValue;
+}
+
+template<typename T>
+QVector<T> sortedUnique(QVector<T> values)
+{
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+    return values;
+}
+}
+
+bool Data::operator==(const FilterAction& lhs, const FilterAction& rhs)
+{
+    return std::tie(lhs.time, lhs.processId, lhs.threadId, lhs.cpuId, lhs.includeSymbols, lhs.excludeSymbols)
+        == std::tie(rhs.time, rhs.processId, rhs.threadId, rhs.cpuId, rhs.includeSymbols, rhs.excludeSymbols)
+        && sortedUnique(lhs.excludeProcessIds) == sortedUnique(rhs.excludeProcessIds)
+        && sortedUnique(lhs.excludeThreadIds) == sortedUnique(rhs.excludeThreadIds)
+        && sortedUnique(lhs.excludeCpuIds) == sortedUnique(rhs.excludeCpuIds);
+}
+
+uint Data::qHash(const FilterAction& filter, uint seed)
+{
+    Util::HashCombine hash;
+    seed = hash(seed, filter.time.start);
+    seed = hash(seed, filter.time.end);
+    seed = hash(seed, filter.processId);
+    seed = hash(seed, filter.threadId);
+    seed = hash(seed, filter.cpuId);
+    seed = hash(seed, sortedUnique(filter.excludeProcessIds));
+    seed = hash(seed, sortedUnique(filter.excludeThreadIds));
+    seed = hash(seed, sortedUnique(filter.excludeCpuIds));
+    seed = hash(seed, filter.includeSymbols);
+    seed = hash(seed, filter.excludeSymbols);
+    return seed;
+}
+
+bool Data::FilterAction::isRefinementOf(const FilterAction& base) const
+{
+    return (!base.time.isValid() || (time.isValid() && time.start >= base.time.start && time.end <= base.time.end))
+        && isNarrowed(processId, base.processId, INVALID_PID) && isNarrowed(threadId, base.threadId, INVALID_TID)
+        && isNarrowed(cpuId, base.cpuId, INVALID_CPU_ID) && isSubset(base.excludeProcessIds, excludeProcessIds)
+        && isSubset(base.excludeThreadIds, excludeThreadIds) && isSubset(base.excludeCpuIds, excludeCpuIds)
+        && isSubset(base.includeSymbols, includeSymbols) && isSubset(base.excludeSymbols, excludeSymbols);
+}
+
+const constexpr quint32 Data::Events::WIDE_COST;
+const constexpr qint16 Data::Events::WIDE_TYPE;
+const constexpr quint16 Data::Events::INVALID_NARROW_CPU_ID;
+const constexpr quint16 Data::Events::WIDE_CPU_ID;
+
+void Data::Events::reserve(int size)
+{
+    m_blockStartTimes.reserve(size / BLOCK_SIZE + 1);
+    m_wideTimeOffsets.reserve(size / BLOCK_SIZE + 1);
+    m_timeDeltas.reserve(size);
+    m_costs.reserve(size);
+    m_types.reserve(size);
+    m_cpuIds.reserve(size);
+    m_stackIds.reserve(size);
+}
+
+void Data::Events::clear()
+{
+    *this = {};
+}
+
+void Data::Events::push_back(const Event& event)
+{
+    const auto index = size();
+    const auto block = index / BLOCK_SIZE;
+    const auto offsetInBlock = index % BLOCK_SIZE;
+    if (offsetInBlock == 0) {
+        m_blockStartTimes.push_back(event.time);
+        m_wideTimeOffsets.push_back(-1);
+    }
+
+    const auto blockStartTime = m_blockStartTimes[block];
+    auto wideOffset = m_wideTimeOffsets[block];
+    if (wideOffset == -1
+        && (event.time < blockStartTime || event.time - blockStartTime > std::numeric_limits<quint32>::max())) {
+        // the delta doesn't fit, store the absolute times for the whole block instead
+        wideOffset = m_wideTimes.size();
+        m_wideTimeOffsets[block] = wideOffset;
+        m_wideTimes.resize(wideOffset + BLOCK_SIZE);
+        for (int i = 0; i < offsetInBlock; ++i) {
+            m_wideTimes[wideOffset + i] = blockStartTime + m_timeDeltas[index - offsetInBlock + i];
+        }
+    }
+
+    if (wideOffset == -1) {
+        m_timeDeltas.push_back(event.time - blockStartTime);
+    } else {
+        m_wideTimes[wideOffset + offsetInBlock] = event.time;
+        m_timeDeltas.push_back(0);
+    }
+
+    if (event.cost >= WIDE_COST) {
+        m_costs.push_back(WIDE_COST);
+        m_wideCosts.insert(index, event.cost);
+    } else {
+        m_costs.push_back(event.cost);
+    }
+
+    if (event.type <= WIDE_TYPE || event.type > std::numeric_limits<qint16>::max()) {
+        m_types.push_back(WIDE_TYPE);
+        m_wideTypes.insert(index, event.type);
+    } else {
+        m_types.push_back(event.type);
+    }
+
+    if (event.cpuId == INVALID_CPU_ID) {
+        m_cpuIds.push_back(INVALID_NARROW_CPU_ID);
+    } else if (event.cpuId >= WIDE_CPU_ID) {
+        m_cpuIds.push_back(WIDE_CPU_ID);
+        m_wideCpuIds.insert(index, event.cpuId);
+    } else {
+        m_cpuIds.push_back(event.cpuId);
+    }
+
+    m_stackIds.push_back(event.stackId);
+}
+
+Data::Events Data::Events::mid(int pos, int length) const
+{
+    const auto end = (length < 0 || pos + length > size()) ? size() : (pos + length);
+    Events ret;
+    ret.reserve(end - pos);
+    for (int i = pos; i < end; ++i) {
+        ret.push_back(at(i));
+    }
+    return ret;
+}
+
+void Data::Events::insert(int pos, const Event& event)
+{
+    Q_ASSERT(pos >= 0 && pos <= size());
+    QVector<Event> tail;
+    tail.reserve(size() - pos);
+    for (int i = pos, c = size(); i < c; ++i) {
+        tail.push_back(at(i));
+    }
+    truncate(pos);
+    push_back(event);
+    for (const auto& tailEvent : tail) {
+        push_back(tailEvent);
+    }
+}
+
+namespace {
+// drops the entries of @p hash whose event index lies in [begin, end) and moves the later ones by @p shift
+template<typename T>
+void removeWideEntries(QHash<int, T>* hash, int begin, int end, int shift)
+{
+    if (hash->isEmpty())
+        return;
+    QHash<int, T> ret;
+    for (auto it = hash->cbegin(); it != hash->cend(); ++it) {
+        if (it.key() < begin)
+            ret.insert(it.key(), it.value());
+        else if (it.key() >= end)
+            ret.insert(it.key() - shift, it.value());
+    }
+    *hash = std::move(ret);
+}
+}
+
+void Data::Events::truncate(int size)
+{
+    if (size >= this->size())
+        return;
+
+    const int numBlocks = (size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    // the absolute times of the wide blocks get appended in block order, drop the ones of the dropped blocks
+    for (int block = numBlocks, c = m_wideTimeOffsets.size(); block < c; ++block) {
+        if (m_wideTimeOffsets[block] != -1) {
+            m_wideTimes.resize(m_wideTimeOffsets[block]);
+            break;
+        }
+    }
+    m_blockStartTimes.resize(numBlocks);
+    m_wideTimeOffsets.resize(numBlocks);
+
+    m_timeDeltas.resize(size);
+    m_costs.resize(size);
+    m_types.resize(size);
+    m_cpuIds.resize(size);
+    m_stackIds.resize(size);
+
+    const auto end = std::numeric_limits<int>::max();
+    removeWideEntries(&m_wideCosts, size, end, 0);
+    removeWideEntries(&m_wideTypes, size, end, 0);
+    removeWideEntries(&m_wideCpuIds, size, end, 0);
+}
+
+int Data::Events::removeLeading(int count)
+{
+    const int numBlocks = std::min(count, size()) / BLOCK_SIZE;
+    count = numBlocks * BLOCK_SIZE;
+    if (!count)
+        return 0;
+
+    // the absolute times of the wide blocks get appended in block order, so the dropped ones come first
+    int numWideTimes = m_wideTimes.size();
+    for (int block = numBlocks, c = m_wideTimeOffsets.size(); block < c; ++block) {
+        if (m_wideTimeOffsets[block] != -1) {
+            numWideTimes = m_wideTimeOffsets[block];
+            break;
+        }
+    }
+    m_wideTimes.remove(0, numWideTimes);
+    m_blockStartTimes.remove(0, numBlocks);
+    m_wideTimeOffsets.remove(0, numBlocks);
+    for (auto& offset : m_wideTimeOffsets) {
+        if (offset != -1)
+            offset -= numWideTimes;
+    }
+
+    m_timeDeltas.remove(0, count);
+    m_costs.remove(0, count);
+    m_types.remove(0, count);
+    m_cpuIds.remove(0, count);
+    m_stackIds.remove(0, count);
+
+    removeWideEntries(&m_wideCosts, 0, count, count);
+    removeWideEntries(&m_wideTypes, 0, count, count);
+    removeWideEntries(&m_wideCpuIds, 0, count, count);
+    return count;
+}
+
+qint64 Data::Events::memoryUsage() const
+{
+    return m_blockStartTimes.size() * (sizeof(quint64) + sizeof(qint32)) + m_wideTimes.size() * sizeof(quint64)
+        + m_wideCosts.size() * (sizeof(int) + sizeof(quint64))
+        + (m_wideTypes.size() + m_wideCpuIds.size()) * (sizeof(int) + sizeof(qint32))
+        + qint64(size()) * (sizeof(quint32) + sizeof(quint32) + sizeof(qint16) + sizeof(quint16) + sizeof(qint32));
+}
+
+bool Data::Events::operator==(const Events& rhs) const
+{
+    if (size() != rhs.size())
+        return false;
+    for (int i = 0, c = size(); i < c; ++i) {
+        if (!(at(i) == rhs.at(i)))
+            return false;
+    }
+    return true;
+}
+
+bool Data::EventsView::operator==(const EventsView& rhs) const
+{
+    if (size() != rhs.size())
+        return false;
+    for (int i = 0, c = size(); i < c; ++i) {
+        if (!(at(i) == rhs.at(i)))
+            return false;
+    }
+    return true;
+}
+
+Data::OffCpuIntervals::OffCpuIntervals(const EventsView& events, qint32 offCpuCostId)
+{
+    if (offCpuCostId < 0)
+        return;
+
+    m_blockedTimes.append(0);
+    quint64 maxEnd = 0;
+    // the events are sorted by time, which is when the thread got switched out
+    for (int i = 0, c = events.size(); i < c; ++i) {
+        if (events.type(i) != offCpuCostId)
+            continue;
+        const auto start = events.time(i);
+        const auto duration = events.cost(i);
+        if (!duration)
+            continue;
+        maxEnd = std::max(maxEnd, start + duration);
+        m_starts.append(start);
+        m_blockedTimes.append(m_blockedTimes.last() + duration);
+        m_maxEnds.append(maxEnd);
+    }
+}
+
+int Data::OffCpuIntervals::find(TimeRange time) const
+{
+    // the periods that start before the end of the range, the latest ones may overlap it
+    auto i = static_cast<int>(std::lower_bound(m_starts.begin(), m_starts.end(), time.end) - m_starts.begin()) - 1;
+    for (; i >= 0 && m_maxEnds[i] > time.start; --i) {
+        if (at(i).end > time.start)
+            return i;
+    }
+    return -1;
+}
+
+quint64 Data::OffCpuIntervals::blockedTimeBefore(quint64 time) const
+{
+    auto i = static_cast<int>(std::lower_bound(m_starts.begin(), m_starts.end(), time) - m_starts.begin());
+    auto ret = m_blockedTimes.value(i);
+    // subtract the remainder of the periods that are still ongoing at @p time
+    for (--i; i >= 0 && m_maxEnds[i] > time; --i) {
+        const auto end = at(i).end;
+        if (end > time)
+            ret -= end - time;
+    }
+    return ret;
+}
+
+quint64 Data::OffCpuIntervals::blockedTime(TimeRange time) const
+{
+    if (isEmpty() || time.start >= time.end)
+        return 0;
+    return blockedTimeBefore(time.end) - blockedTimeBefore(time.start);
+}
+
+quint64 Data::blockedTimeInRange(const Events& events, qint32 offCpuCostId, TimeRange time)
+{
+    if (offCpuCostId < 0 || time.start >= time.end)
+        return 0;
+
+    auto it = findEventsInTimeRange(events, time).first;
+    // a thread is switched out at most once at a time, so only the latest earlier period can reach into the range
+    for (auto previous = it; previous != events.begin();) {
+        --previous;
+        if (previous->type == offCpuCostId) {
+            it = previous;
+            break;
+        }
+    }
+
+    quint64 ret = 0;
+    for (; it != events.end() && it->time < time.end; ++it) {
+        if (it->type != offCpuCostId)
+            continue;
+        const auto start = std::max(it->time, time.start);
+        const auto end = std::min(it->time + it->cost, time.end);
+        if (start < end)
+            ret += end - start;
+    }
+    return ret;
+}
+
+Data::EventPyramid::EventPyramid(const EventsView& events, int numCostTypes, qint32 offCpuCostId)
+    : m_events(events)
+    , m_numCostTypes(numCostTypes)
+    , m_offCpuIntervals(events, offCpuCostId < numCostTypes ? offCpuCostId : -1)
+{
+    if (events.isEmpty() || numCostTypes <= 0)
+        return;
+
+    const auto numEvents = events.size();
+    m_time = {events.time(0), events.time(numEvents - 1) + 1};
+
+    const quint64 targetBuckets = std::max(1, numEvents / EVENTS_PER_BUCKET);
+    m_bucketSize = std::max(quint64(1), (m_time.delta() + targetBuckets - 1) / targetBuckets);
+    const auto numBuckets = static_cast<int>((m_time.delta() + m_bucketSize - 1) / m_bucketSize);
+
+    QVector<Bucket> buckets(numBuckets * numCostTypes);
+    for (int i = 0; i < numEvents; ++i) {
+        const auto type = events.type(i);
+        if (type < 0 || type >= numCostTypes)
+            continue;
+        buckets[bucketIndex(events.time(i)) * numCostTypes + type].add(events.cost(i));
+    }
+    m_levels.append(buckets);
+
+    while (m_levels.last().size() > numCostTypes) {
+        const auto below = m_levels.last();
+        const auto numBelow = below.size() / numCostTypes;
+        QVector<Bucket> level((numBelow + 1) / 2 * numCostTypes);
+        for (int i = 0; i < numBelow; ++i) {
+            for (int type = 0; type < numCostTypes; ++type)
+                level[i / 2 * numCostTypes + type].add(below[i * numCostTypes + type]);
+        }
+        m_levels.append(level);
+    }
+}
+
+namespace {
+// calls @p callback with the level and index of the buckets that exactly cover the buckets [begin, end) of level 0
+template<typename Callback>
+void forEachBucket(int begin, int end, Callback callback)
+{
+    for (int level = 0; begin < end; ++level) {
+        if (begin & 1)
+            callback(level, begin++);
+        if (end & 1)
+            callback(level, --end);
+        begin /= 2;
+        end /= 2;
+    }
+}
+}
+
+void Data::EventPyramid::addEvents(Bucket* bucket, qint32 type, quint64 start, quint64 end) const
+{
+    for (int i = m_events.lowerBound(start), c = m_events.size(); i < c; ++i) {
+        if (m_events.time(i) >= end)
+            break;
+        if (m_events.type(i) == type)
+            bucket->add(m_events.cost(i));
+    }
+}
+
+Data::EventPyramid::Bucket Data::EventPyramid::query(qint32 type, TimeRange time) const
+{
+    Bucket ret;
+    const auto start = std::max(time.start, m_time.start);
+    const auto end = std::min(time.end, m_time.end);
+    if (m_levels.isEmpty() || start >= end || type < 0 || type >= m_numCostTypes)
+        return ret;
+
+    // only the buckets at the borders of the range need to look at the individual events
+    auto first = bucketIndex(start);
+    auto last = bucketIndex(end - 1) + 1;
+    if (bucketStart(first) != start) {
+        const auto firstEnd = std::min(bucketStart(first + 1), end);
+        addEvents(&ret, type, start, firstEnd);
+        if (firstEnd == end)
+            return ret;
+        ++first;
+    }
+    if (bucketStart(last) > end && end != m_time.end) {
+        --last;
+        addEvents(&ret, type, bucketStart(last), end);
+    }
+
+    forEachBucket(first, last, [this, type, &ret](int level, int bucket) {
+        ret.add(m_levels[level][bucket * m_numCostTypes + type]);
+    });
+    return ret;
+}
+
 Data::ThreadEvents* Data::EventResults::findThread(qint32 pid, qint32 tid)
 {
     for (int i = threads.size() - 1; i >= 0; --i) {
@@ -350,3 +1118,25 @@ const Data::ThreadEvents* Data::EventResults::findThread(qint32 pid, qint32 tid)
 {
     return const_cast<Data::EventResults*>(this)->findThread(pid, tid);
 }
+
+QVector<qint32> Data::EventResults::stackFrames(qint32 stackId) const
+{
+    QVector<qint32> frames;
+    // the root has no frame
+    while (stackId > 0) {
+        const auto& node = stacks[stackId];
+        frames.push_back(node.locationId);
+        stackId = node.parent;
+    }
+    return frames;
+}
+
+Data::Events Data::EventResults::eventsForCpu(const CpuEvents& cpu) const
+{
+    Events events;
+    events.reserve(cpu.events.size());
+    for (const auto& index : cpu.events) {
+        events.push_back(threads[index.thread].events.at(index.event));
+    }
+    return events;
+}
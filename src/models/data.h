@@ -29,14 +29,18 @@
 
 #include <QHash>
 #include <QMetaType>
+#include <QSharedPointer>
 #include <QString>
 #include <QTypeInfo>
 #include <QVector>
 #include <QSet>
+#include <QSharedData>
 
 #include "../util.h"
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <tuple>
 #include <valarray>
@@ -48,20 +52,25 @@ struct Symbol
 {
     Symbol(const QString& symbol = {}, const QString& binary = {}, const QString& path = {})
         : symbol(symbol)
-        , prettySymbol(Data::prettifySymbol(symbol))
         , binary(binary)
         , path(path)
     {
     }
 
+    // prettified function name, only computed once for interned symbols
+    QString prettySymbol() const;
+    // remembers the prettified function name, all copies of this symbol share it from then on
+    // used for the unique symbols of BottomUpResults::symbolTable
+    void internPrettySymbol();
+
     // function name
     QString symbol;
-    // prettified function name
-    QString prettySymbol;
     // dso / executable name
     QString binary;
     // path to dso / executable
     QString path;
+    // the prettified function name once internPrettySymbol got called, ignored when comparing symbols
+    QString pretty;
 
     bool operator<(const Symbol& rhs) const
     {
@@ -95,6 +104,15 @@ inline uint qHash(const Symbol& symbol, uint seed = 0)
     return seed;
 }
 
+/**
+ * Dense index of a unique symbol, see BottomUpResults::symbolTable.
+ *
+ * Comparing and hashing these is much cheaper than doing the same on the strings of a Symbol,
+ * which is why the hot paths operate on symbol ids and only resolve the strings for display.
+ */
+using SymbolId = qint32;
+const constexpr SymbolId INVALID_SYMBOL_ID = -1;
+
 struct Location
 {
     Location(quint64 address = 0, const QString& location = {})
@@ -149,6 +167,11 @@ using ItemCost = std::valarray<qint64>;
 
 QDebug operator<<(QDebug stream, const ItemCost& cost);
 
+/**
+ * The costs of all items, stored as a dense matrix with one row per item id and
+ * one column per cost type. Keeping the costs of an item next to each other allows
+ * to add up complete rows without allocating temporary ItemCost values.
+ */
 class Costs
 {
 public:
@@ -165,8 +188,8 @@ public:
 
     void add(int type, quint32 id, qint64 delta)
     {
-        ensureSpaceAvailable(type, id);
-        m_costs[type][id] += delta;
+        ensureSpaceAvailable(id);
+        m_costs[id * numTypes() + type] += delta;
     }
 
     void incrementTotal(int type)
@@ -191,11 +214,8 @@ public:
 
     void addType(int type, const QString& name, Unit unit)
     {
-        if (m_costs.size() <= type) {
-            m_costs.resize(type + 1);
-            m_typeNames.resize(type + 1);
-            m_totalCosts.resize(type + 1);
-            m_units.resize(type + 1);
+        if (numTypes() <= type) {
+            setNumTypes(type + 1);
         }
         m_typeNames[type] = name;
         m_units[type] = unit;
@@ -208,11 +228,15 @@ public:
 
     qint64 cost(int type, quint32 id) const
     {
-        if (static_cast<quint32>(m_costs[type].size()) > id) {
-            return m_costs[type][id];
-        } else {
-            return 0;
-        }
+        const auto costs = row(id);
+        return costs ? costs[type] : 0;
+    }
+
+    // the costs of @p id for all types, or null when no cost was added for it yet
+    // only valid until the costs get modified
+    const qint64* row(quint32 id) const
+    {
+        return id < numRows() ? (m_costs.constData() + id * numTypes()) : nullptr;
     }
 
     qint64 totalCost(int type) const
@@ -232,32 +256,48 @@ public:
 
     ItemCost itemCost(quint32 id) const
     {
-        ItemCost cost;
-        cost.resize(m_costs.size());
-        for (int i = 0, c = numTypes(); i < c; ++i) {
-            if (static_cast<quint32>(m_costs[i].size()) > id) {
-                cost[i] = m_costs[i][id];
-            } else {
-                cost[i] = 0;
-            }
+        ItemCost cost(qint64(0), numTypes());
+        if (const auto costs = row(id)) {
+            std::copy_n(costs, numTypes(), std::begin(cost));
         }
         return cost;
     }
 
     void add(quint32 id, const ItemCost& cost)
     {
-        Q_ASSERT(cost.size() == static_cast<quint32>(m_costs.size()));
-        for (int i = 0, c = numTypes(); i < c; ++i) {
-            ensureSpaceAvailable(i, id);
-            m_costs[i][id] += cost[i];
+        Q_ASSERT(cost.size() == static_cast<size_t>(numTypes()));
+        if (numTypes()) {
+            add(id, &cost[0]);
+        }
+    }
+
+    // adds @p cost, which holds the costs of all types, to the costs of @p id
+    void add(quint32 id, const qint64* cost)
+    {
+        ensureSpaceAvailable(id);
+        addRow(m_costs.data() + id * numTypes(), cost, numTypes());
+    }
+
+    // these loops get vectorized by the compiler, keep them simple
+    static void addRow(qint64* lhs, const qint64* rhs, int numTypes)
+    {
+        for (int i = 0; i < numTypes; ++i) {
+            lhs[i] += rhs[i];
+        }
+    }
+
+    static void subtractRow(qint64* lhs, const qint64* rhs, int numTypes)
+    {
+        for (int i = 0; i < numTypes; ++i) {
+            lhs[i] -= rhs[i];
         }
     }
 
     void initializeCostsFrom(const Costs& rhs)
     {
+        setNumTypes(rhs.numTypes());
         m_typeNames = rhs.m_typeNames;
         m_units = rhs.m_units;
-        m_costs.resize(rhs.m_costs.size());
         m_totalCosts = rhs.m_totalCosts;
     }
 
@@ -283,15 +323,47 @@ public:
     }
 
 private:
-    void ensureSpaceAvailable(int type, quint32 id)
+    quint32 numRows() const
     {
-        while (static_cast<quint32>(m_costs[type].size()) <= id) {
-            // don't use resize, we don't want to influence the internal auto-sizing
-            m_costs[type].push_back(0);
+        return numTypes() ? static_cast<quint32>(m_costs.size() / numTypes()) : 0;
+    }
+
+    void ensureSpaceAvailable(quint32 id)
+    {
+        const int size = (id + 1) * numTypes();
+        if (m_costs.size() < size) {
+            // grow geometrically, ids get added one after the other
+            if (m_costs.capacity() < size) {
+                m_costs.reserve(std::max(size, 2 * m_costs.capacity()));
+            }
+            m_costs.resize(size);
         }
     }
+
+    void setNumTypes(int numTypes)
+    {
+        const auto oldNumTypes = this->numTypes();
+        if (numTypes == oldNumTypes) {
+            return;
+        }
+
+        // the row stride changes, so the existing costs need to be moved
+        const auto rows = numRows();
+        QVector<qint64> costs(rows * numTypes, 0);
+        const auto commonTypes = std::min(numTypes, oldNumTypes);
+        for (quint32 id = 0; id < rows; ++id) {
+            std::copy_n(m_costs.constData() + id * oldNumTypes, commonTypes, costs.data() + id * numTypes);
+        }
+        m_costs = costs;
+
+        m_typeNames.resize(numTypes);
+        m_totalCosts.resize(numTypes);
+        m_units.resize(numTypes);
+    }
+
     QVector<QString> m_typeNames;
-    QVector<QVector<qint64>> m_costs;
+    // the costs of item id and type are at id * numTypes() + type
+    QVector<qint64> m_costs;
     QVector<qint64> m_totalCosts;
     QVector<Unit> m_units;
 };
@@ -325,6 +397,42 @@ template<typename Impl>
 struct SymbolTree : Tree<Impl>
 {
     Symbol symbol;
+    // only set for trees that were built from interned symbols
+    SymbolId symbolId = INVALID_SYMBOL_ID;
+
+    // compares the ids instead of the strings, falls back to the latter for symbols without id
+    // nodes with many children look them up via a hash on the symbol id instead of scanning them
+    Impl* entryForSymbol(SymbolId symbolId, const Symbol& symbol, quint32* maxId)
+    {
+        if (symbolId == INVALID_SYMBOL_ID) {
+            return entryForSymbol(symbol, maxId);
+        }
+
+        auto& children = this->children;
+        if (children.size() < CHILD_INDEX_THRESHOLD) {
+            for (auto row = children.data(), end = row + children.size(); row != end; ++row) {
+                if (row->symbolId == symbolId) {
+                    return row;
+                }
+            }
+        } else {
+            updateChildIndex();
+            const auto& indices = childIndex.constData()->indices;
+            auto it = indices.constFind(symbolId);
+            if (it != indices.constEnd()) {
+                Q_ASSERT(children[*it].symbolId == symbolId);
+                return &children[*it];
+            }
+        }
+
+        Impl frame;
+        frame.symbol = symbol;
+        frame.symbolId = symbolId;
+        frame.id = *maxId;
+        *maxId += 1;
+        children.append(frame);
+        return &children.last();
+    }
 
     Impl* entryForSymbol(const Symbol& symbol, quint32* maxId)
     {
@@ -364,6 +472,45 @@ struct SymbolTree : Tree<Impl>
 
         return ret;
     }
+
+    // the child index only picks up appended children, call this after reordering or removing children
+    void invalidateChildIndex()
+    {
+        childIndex = nullptr;
+    }
+
+private:
+    enum
+    {
+        CHILD_INDEX_THRESHOLD = 16
+    };
+
+    // maps symbol ids to the index of the first child with that id, covers the first indexedChildren
+    struct ChildIndex : QSharedData
+    {
+        QHash<SymbolId, int> indices;
+        int indexedChildren = 0;
+    };
+    // only allocated for nodes with many children, copies of the node share it until either one changes
+    QSharedDataPointer<ChildIndex> childIndex;
+
+    void updateChildIndex()
+    {
+        const auto& children = this->children;
+        if (!childIndex || childIndex.constData()->indexedChildren > children.size()) {
+            childIndex = new ChildIndex;
+        } else if (childIndex.constData()->indexedChildren == children.size()) {
+            return;
+        }
+
+        auto* index = childIndex.data();
+        for (int c = children.size(); index->indexedChildren < c; ++index->indexedChildren) {
+            const auto symbolId = children[index->indexedChildren].symbolId;
+            if (symbolId != INVALID_SYMBOL_ID && !index->indices.contains(symbolId)) {
+                index->indices.insert(symbolId, index->indexedChildren);
+            }
+        }
+    }
 };
 
 struct BottomUp : SymbolTree<BottomUp>
@@ -371,42 +518,177 @@ struct BottomUp : SymbolTree<BottomUp>
     quint32 id;
 };
 
+/**
+ * A bottom up tree stored in a flat node array, linked via indices instead of pointers.
+ *
+ * All nodes share a single allocation and the cost row of a node is its index, which
+ * makes building trees with millions of nodes much cheaper than nesting the children.
+ * The first node is the root. Use BottomUpResults::merge to add it to a BottomUp tree.
+ */
+struct FlatBottomUp
+{
+    struct Node
+    {
+        Node() = default;
+        Node(qint32 parent, SymbolId symbolId)
+            : parent(parent)
+            , symbolId(symbolId)
+        {
+        }
+
+        qint32 parent = -1;
+        qint32 firstChild = -1;
+        qint32 lastChild = -1;
+        qint32 nextSibling = -1;
+        qint32 numChildren = 0;
+        SymbolId symbolId = INVALID_SYMBOL_ID;
+    };
+
+    FlatBottomUp()
+        : nodes(1)
+    {
+    }
+
+    QVector<Node> nodes;
+    Costs costs;
+
+    // returns the child of @p parent for @p symbolId, appending it to the children when needed
+    qint32 child(qint32 parent, SymbolId symbolId)
+    {
+        const bool isWide = nodes[parent].numChildren >= CHILD_INDEX_THRESHOLD;
+        if (isWide) {
+            const auto child = wideChildren.value(childKey(parent, symbolId), -1);
+            if (child != -1) {
+                return child;
+            }
+        } else {
+            const auto* node = nodes.constData();
+            for (auto child = node[parent].firstChild; child != -1; child = node[child].nextSibling) {
+                if (node[child].symbolId == symbolId) {
+                    return child;
+                }
+            }
+        }
+
+        const qint32 child = nodes.size();
+        nodes.push_back({parent, symbolId});
+        auto& parentNode = nodes[parent];
+        if (parentNode.lastChild == -1) {
+            parentNode.firstChild = child;
+        } else {
+            nodes[parentNode.lastChild].nextSibling = child;
+        }
+        parentNode.lastChild = child;
+        ++parentNode.numChildren;
+
+        if (isWide) {
+            wideChildren.insert(childKey(parent, symbolId), child);
+        } else if (parentNode.numChildren == CHILD_INDEX_THRESHOLD) {
+            // the node just became wide, index all of its children
+            for (auto sibling = parentNode.firstChild; sibling != -1; sibling = nodes[sibling].nextSibling) {
+                wideChildren.insert(childKey(parent, nodes[sibling].symbolId), sibling);
+            }
+        }
+        return child;
+    }
+
+private:
+    enum
+    {
+        CHILD_INDEX_THRESHOLD = 16
+    };
+
+    static quint64 childKey(qint32 parent, SymbolId symbolId)
+    {
+        return (quint64(quint32(parent)) << 32) | quint32(symbolId);
+    }
+
+    // the children of nodes with many children, keyed by the parent node and symbol id
+    QHash<quint64, qint32> wideChildren;
+};
+
 struct BottomUpResults
 {
     BottomUp root;
     Costs costs;
+    // the symbol of every location, as well as its interned id
     QVector<Data::Symbol> symbols;
+    QVector<Data::SymbolId> symbolIds;
+    // the unique, valid symbols, indexed by their id
+    QVector<Data::Symbol> symbolTable;
     QVector<Data::FrameLocation> locations;
 
     // callback should return true to continue iteration or false otherwise
     template<typename FrameCallback>
     void foreachFrame(const QVector<qint32>& frames, FrameCallback frameCallback) const
     {
-        for (auto id : frames) {
-            if (!handleFrame(id, frameCallback)) {
-                break;
-            }
-        }
+        foreachFrameId(frames, [this, &frameCallback](qint32 symbolLocationId, const Data::Location& location) {
+            return frameCallback(symbol(symbolLocationId), location);
+        });
     }
 
-    // callback return type is ignored, all frames will be iterated over
+    // like foreachFrame, but the callback gets the interned id of the symbol instead
     template<typename FrameCallback>
-    const BottomUp* addEvent(int type, quint64 cost, const QVector<qint32>& frames, FrameCallback frameCallback)
-    {
-        costs.addTotalCost(type, cost);
-        auto parent = &root;
-        foreachFrame(frames, [this, type, cost, &parent, frameCallback](const Data::Symbol &symbol, const Data::Location &location) {
-            parent = parent->entryForSymbol(symbol, &maxBottomUpId);
-            costs.add(type, parent->id, cost);
-            frameCallback(symbol, location);
-            return true;
+    void foreachFrameSymbolId(const QVector<qint32>& frames, FrameCallback frameCallback) const
+    {
+        foreachFrameId(frames, [this, &frameCallback](qint32 symbolLocationId, const Data::Location& location) {
+            return frameCallback(symbolIds.value(symbolLocationId, INVALID_SYMBOL_ID), location);
+        });
+    }
+
+    // like the above, but for a single frame including the frames inlined into it
+    template<typename FrameCallback>
+    void foreachFrameSymbolId(qint32 locationId, FrameCallback frameCallback) const
+    {
+        handleFrame(locationId, [this, &frameCallback](qint32 symbolLocationId, const Data::Location& location) {
+            return frameCallback(symbolIds.value(symbolLocationId, INVALID_SYMBOL_ID), location);
         });
-        return parent;
     }
 
+    // resolves the frames via our symbols and locations and adds them to @p tree, which gets merged later on
+    // callback gets the symbol id and location of every frame, its return type is ignored
+    template<typename FrameCallback>
+    void addEvent(FlatBottomUp* tree, int type, quint64 cost, const QVector<qint32>& frames,
+                  FrameCallback frameCallback) const
+    {
+        tree->costs.addTotalCost(type, cost);
+        qint32 parent = 0;
+        auto addFrame = [this, tree, type, cost, &parent, &frameCallback](qint32 symbolLocationId,
+                                                                           const Data::Location& location) {
+            const auto symbolId = symbolIds.value(symbolLocationId, INVALID_SYMBOL_ID);
+            parent = tree->child(parent, symbolId);
+            tree->costs.add(type, parent, cost);
+            frameCallback(symbolId, location);
+            return true;
+        };
+        foreachFrameId(frames, addFrame);
+    }
+
+    // add the tree and costs of @p partial, which got built via addEvent on our tables
+    void merge(const FlatBottomUp& partial);
+
 private:
     quint32 maxBottomUpId = 0;
 
+    void merge(const FlatBottomUp& partial, qint32 partialParent, BottomUp* parent);
+
+    const Data::Symbol& symbol(qint32 locationId) const
+    {
+        static const Data::Symbol invalidSymbol;
+        return (locationId >= 0 && locationId < symbols.size()) ? symbols[locationId] : invalidSymbol;
+    }
+
+    // callback gets the id of the location that holds the symbol, which may differ from the frame location
+    template<typename FrameCallback>
+    void foreachFrameId(const QVector<qint32>& frames, FrameCallback frameCallback) const
+    {
+        for (auto id : frames) {
+            if (!handleFrame(id, frameCallback)) {
+                break;
+            }
+        }
+    }
+
     template<typename FrameCallback>
     bool handleFrame(qint32 locationId, FrameCallback frameCallback) const
     {
@@ -419,15 +701,15 @@ private:
                 continue;
             }
 
-            auto symbol = symbols.value(locationId);
-            if (!symbol.isValid()) {
+            auto symbolLocationId = locationId;
+            if (!symbol(locationId).isValid()) {
                 // we get function entry points from the perfparser but
                 // those are imo not interesting - skip them
-                symbol = symbols.value(location.parentLocationId);
+                symbolLocationId = location.parentLocationId;
                 skipNextFrame = true;
             }
 
-            if (!frameCallback(symbol, location.location)) {
+            if (!frameCallback(symbolLocationId, location.location)) {
                 return false;
             }
 
@@ -448,6 +730,17 @@ struct TopDownResults
     Costs selfCosts;
     Costs inclusiveCosts;
     static TopDownResults fromBottomUp(const Data::BottomUpResults& bottomUpData);
+    // only handles the children of the bottom up root in [begin, end), merge the partial results afterwards
+    static TopDownResults fromBottomUp(const Data::BottomUpResults& bottomUpData, int begin, int end);
+
+    // add the tree and costs of @p partial, new rows get their ids in the order of @p partial
+    // the parent pointers get invalidated, call TopDown::initializeParents after the last merge
+    void merge(const TopDownResults& partial);
+
+private:
+    quint32 maxTopDownId = 0;
+
+    void merge(const TopDownResults& partial, const TopDown& partialParent, TopDown* parent);
 };
 
 using SymbolCostMap = QHash<Symbol, ItemCost>;
@@ -526,9 +819,14 @@ struct CallerCalleeResults
         }
         return *it;
     }
+
+    // add the entries and costs of @p partial, new entries get their ids in the order of @p partial
+    void merge(const CallerCalleeResults& partial);
 };
 
 void callerCalleesFromBottomUpData(const BottomUpResults& data, CallerCalleeResults* results);
+// only handles the children of the bottom up root in [begin, end), merge the partial results afterwards
+void callerCalleesFromBottomUpData(const BottomUpResults& data, CallerCalleeResults* results, int begin, int end);
 
 const constexpr auto INVALID_CPU_ID = std::numeric_limits<quint32>::max();
 const constexpr int INVALID_TID = -1;
@@ -549,7 +847,325 @@ struct Event
     }
 };
 
-using Events = QVector<Event>;
+/**
+ * Columnar storage for the events of a thread, sorted by time.
+ *
+ * Storing every event as a Data::Event wastes most of the space on padding and on
+ * wide fields that only ever hold small values. Instead, every field is stored in
+ * its own column: timestamps are delta-encoded relative to the first event of a
+ * fixed-size block, costs, types and cpu ids use narrow columns and values that
+ * don't fit are kept on the side. Random access stays O(1), which keeps binary
+ * searches on the time column cheap.
+ */
+class Events
+{
+public:
+    using value_type = Event;
+
+    class const_iterator
+    {
+    public:
+        struct ArrowProxy
+        {
+            Event event;
+            const Event* operator->() const
+            {
+                return &event;
+            }
+        };
+
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Event;
+        using difference_type = std::ptrdiff_t;
+        using pointer = ArrowProxy;
+        using reference = Event;
+
+        const_iterator() = default;
+        const_iterator(const Events* events, int index)
+            : m_events(events)
+            , m_index(index)
+        {
+        }
+
+        int index() const
+        {
+            return m_index;
+        }
+
+        Event operator*() const
+        {
+            return m_events->at(m_index);
+        }
+
+        ArrowProxy operator->() const
+        {
+            return {m_events->at(m_index)};
+        }
+
+        Event operator[](difference_type offset) const
+        {
+            return m_events->at(m_index + offset);
+        }
+
+        const_iterator& operator++()
+        {
+            ++m_index;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto ret = *this;
+            ++m_index;
+            return ret;
+        }
+
+        const_iterator& operator--()
+        {
+            --m_index;
+            return *this;
+        }
+
+        const_iterator operator--(int)
+        {
+            auto ret = *this;
+            --m_index;
+            return ret;
+        }
+
+        const_iterator& operator+=(difference_type offset)
+        {
+            m_index += offset;
+            return *this;
+        }
+
+        const_iterator& operator-=(difference_type offset)
+        {
+            m_index -= offset;
+            return *this;
+        }
+
+        const_iterator operator+(difference_type offset) const
+        {
+            return {m_events, int(m_index + offset)};
+        }
+
+        const_iterator operator-(difference_type offset) const
+        {
+            return {m_events, int(m_index - offset)};
+        }
+
+        difference_type operator-(const const_iterator& rhs) const
+        {
+            return m_index - rhs.m_index;
+        }
+
+        bool operator==(const const_iterator& rhs) const
+        {
+            return m_index == rhs.m_index && m_events == rhs.m_events;
+        }
+
+        bool operator!=(const const_iterator& rhs) const
+        {
+            return !operator==(rhs);
+        }
+
+        bool operator<(const const_iterator& rhs) const
+        {
+            return m_index < rhs.m_index;
+        }
+
+        bool operator>(const const_iterator& rhs) const
+        {
+            return m_index > rhs.m_index;
+        }
+
+        bool operator<=(const const_iterator& rhs) const
+        {
+            return m_index <= rhs.m_index;
+        }
+
+        bool operator>=(const const_iterator& rhs) const
+        {
+            return m_index >= rhs.m_index;
+        }
+
+    private:
+        const Events* m_events = nullptr;
+        int m_index = 0;
+    };
+    using iterator = const_iterator;
+
+    int size() const
+    {
+        return m_timeDeltas.size();
+    }
+
+    bool isEmpty() const
+    {
+        return m_timeDeltas.isEmpty();
+    }
+
+    void reserve(int size);
+    void clear();
+    void push_back(const Event& event);
+
+    void append(const Event& event)
+    {
+        push_back(event);
+    }
+
+    Events& operator<<(const Event& event)
+    {
+        push_back(event);
+        return *this;
+    }
+
+    quint64 time(int i) const
+    {
+        const auto block = i / BLOCK_SIZE;
+        const auto wideOffset = m_wideTimeOffsets[block];
+        if (wideOffset != -1)
+            return m_wideTimes[wideOffset + i % BLOCK_SIZE];
+        return m_blockStartTimes[block] + m_timeDeltas[i];
+    }
+
+    quint64 cost(int i) const
+    {
+        const auto cost = m_costs[i];
+        if (cost == WIDE_COST)
+            return m_wideCosts.value(i);
+        return cost;
+    }
+
+    qint32 type(int i) const
+    {
+        const auto type = m_types[i];
+        if (type == WIDE_TYPE)
+            return m_wideTypes.value(i);
+        return type;
+    }
+
+    qint32 stackId(int i) const
+    {
+        return m_stackIds[i];
+    }
+
+    quint32 cpuId(int i) const
+    {
+        const auto cpuId = m_cpuIds[i];
+        if (cpuId == INVALID_NARROW_CPU_ID)
+            return INVALID_CPU_ID;
+        else if (cpuId == WIDE_CPU_ID)
+            return m_wideCpuIds.value(i);
+        return cpuId;
+    }
+
+    Event at(int i) const
+    {
+        Event event;
+        event.time = time(i);
+        event.cost = cost(i);
+        event.type = type(i);
+        event.stackId = stackId(i);
+        event.cpuId = cpuId(i);
+        return event;
+    }
+
+    Event operator[](int i) const
+    {
+        return at(i);
+    }
+
+    Event first() const
+    {
+        return at(0);
+    }
+
+    Event last() const
+    {
+        return at(size() - 1);
+    }
+
+    Events mid(int pos, int length = -1) const;
+
+    // inserts @p event before the event at @p pos, which re-encodes all events after it
+    // meant for events that arrive slightly out of order, use push_back otherwise
+    void insert(int pos, const Event& event);
+
+    // drops the events from @p size on
+    void truncate(int size);
+
+    // drops the first @p count events, rounded down to whole blocks such that the remaining events
+    // don't need to be re-encoded, returns the number of events that got dropped
+    int removeLeading(int count);
+
+    const_iterator begin() const
+    {
+        return {this, 0};
+    }
+
+    const_iterator end() const
+    {
+        return {this, size()};
+    }
+
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    const_iterator constBegin() const
+    {
+        return begin();
+    }
+
+    const_iterator constEnd() const
+    {
+        return end();
+    }
+
+    // roughly the number of bytes allocated to store the events
+    qint64 memoryUsage() const;
+
+    bool operator==(const Events& rhs) const;
+
+    bool operator!=(const Events& rhs) const
+    {
+        return !operator==(rhs);
+    }
+
+private:
+    enum : int
+    {
+        BLOCK_SIZE = 256
+    };
+    static const constexpr quint32 WIDE_COST = std::numeric_limits<quint32>::max();
+    static const constexpr qint16 WIDE_TYPE = std::numeric_limits<qint16>::min();
+    static const constexpr quint16 INVALID_NARROW_CPU_ID = std::numeric_limits<quint16>::max();
+    static const constexpr quint16 WIDE_CPU_ID = INVALID_NARROW_CPU_ID - 1;
+
+    // time of the first event in every block
+    QVector<quint64> m_blockStartTimes;
+    // for blocks whose deltas don't fit into 32bit, the offset of its absolute times in m_wideTimes, or -1
+    QVector<qint32> m_wideTimeOffsets;
+    QVector<quint64> m_wideTimes;
+    QVector<quint32> m_timeDeltas;
+    QVector<quint32> m_costs;
+    // costs that don't fit into 32bit, e.g. long off-CPU periods, indexed by event
+    QHash<int, quint64> m_wideCosts;
+    QVector<qint16> m_types;
+    // types and cpu ids that don't fit into 16bit, indexed by event
+    QHash<int, qint32> m_wideTypes;
+    QVector<quint16> m_cpuIds;
+    QHash<int, quint32> m_wideCpuIds;
+    QVector<qint32> m_stackIds;
+};
 
 struct TimeRange
 {
@@ -604,6 +1220,21 @@ struct TimeRange
 const constexpr auto MAX_TIME = std::numeric_limits<quint64>::max();
 const constexpr auto MAX_TIME_RANGE = TimeRange {0, MAX_TIME};
 
+// the events are sorted by time, returns the range of events that lie within @p time
+inline std::pair<Events::const_iterator, Events::const_iterator> findEventsInTimeRange(const Events& events,
+                                                                                       TimeRange time)
+{
+    auto begin = std::lower_bound(events.begin(), events.end(), time.start,
+                                  [](const Event& event, quint64 time) { return event.time < time; });
+    auto end = std::upper_bound(begin, events.end(), time.end,
+                                [](quint64 time, const Event& event) { return time < event.time; });
+    return {begin, end};
+}
+
+// the time spent off-CPU within @p time according to the @p offCpuCostId events of a single thread
+// unlike OffCpuIntervals this only looks at the events near @p time, but the periods must not overlap
+quint64 blockedTimeInRange(const Events& events, qint32 offCpuCostId, TimeRange time);
+
 struct ThreadEvents
 {
     qint32 pid = INVALID_PID;
@@ -629,10 +1260,30 @@ struct ThreadEvents
     }
 };
 
+// identifies an event by the index of its thread in EventResults::threads and its index in the thread's events
+struct EventIndex
+{
+    EventIndex() = default;
+    EventIndex(qint32 thread, qint32 event)
+        : thread(thread)
+        , event(event)
+    {
+    }
+
+    qint32 thread = -1;
+    qint32 event = -1;
+
+    bool operator==(const EventIndex& rhs) const
+    {
+        return std::tie(thread, event) == std::tie(rhs.thread, rhs.event);
+    }
+};
+
 struct CpuEvents
 {
     quint32 cpuId = INVALID_CPU_ID;
-    QVector<Event> events;
+    // the events are owned by the threads, we only reference them here
+    QVector<EventIndex> events;
 
     bool operator==(const CpuEvents& rhs) const
     {
@@ -640,6 +1291,242 @@ struct CpuEvents
     }
 };
 
+/**
+ * Read access to the events of a timeline row, without copying them.
+ *
+ * This either wraps the events of a thread or resolves the indices of the events of a cpu into the events
+ * of the threads. Either way, the events are sorted by time.
+ */
+class EventsView
+{
+public:
+    EventsView() = default;
+
+    // implicit, such that the events of a thread can be passed wherever a view is expected
+    EventsView(const Events& events)
+        : m_events(events)
+    {
+    }
+
+    EventsView(const QVector<ThreadEvents>& threads, const QVector<EventIndex>& indices)
+        : m_threads(threads)
+        , m_indices(indices)
+        , m_isIndexed(true)
+    {
+    }
+
+    int size() const
+    {
+        return m_isIndexed ? m_indices.size() : m_events.size();
+    }
+
+    bool isEmpty() const
+    {
+        return size() == 0;
+    }
+
+    quint64 time(int i) const
+    {
+        if (!m_isIndexed)
+            return m_events.time(i);
+        const auto& index = m_indices[i];
+        return m_threads[index.thread].events.time(index.event);
+    }
+
+    quint64 cost(int i) const
+    {
+        if (!m_isIndexed)
+            return m_events.cost(i);
+        const auto& index = m_indices[i];
+        return m_threads[index.thread].events.cost(index.event);
+    }
+
+    qint32 type(int i) const
+    {
+        if (!m_isIndexed)
+            return m_events.type(i);
+        const auto& index = m_indices[i];
+        return m_threads[index.thread].events.type(index.event);
+    }
+
+    Event at(int i) const
+    {
+        if (!m_isIndexed)
+            return m_events.at(i);
+        const auto& index = m_indices[i];
+        return m_threads[index.thread].events.at(index.event);
+    }
+
+    // the index of the first event at or after @p time
+    int lowerBound(quint64 time) const
+    {
+        int first = 0;
+        int count = size();
+        while (count > 0) {
+            const int step = count / 2;
+            if (this->time(first + step) < time) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    bool operator==(const EventsView& rhs) const;
+
+    bool operator!=(const EventsView& rhs) const
+    {
+        return !operator==(rhs);
+    }
+
+private:
+    Events m_events;
+    QVector<ThreadEvents> m_threads;
+    QVector<EventIndex> m_indices;
+    bool m_isIndexed = false;
+};
+
+/**
+ * Index of the off-CPU periods of a timeline row, sorted by their start time.
+ *
+ * Off-CPU periods are recorded as events of the off-CPU cost type, which are interleaved with all other
+ * events of a thread and store the duration as their cost. Collecting them here together with prefix sums
+ * of their durations allows point and range queries via binary search. Only the periods that overlap the
+ * queried time need to be looked at individually, for a thread that is at most one of them. The periods
+ * of different threads on a CPU may overlap though, their durations are then added up.
+ */
+class OffCpuIntervals
+{
+public:
+    OffCpuIntervals() = default;
+    OffCpuIntervals(const EventsView& events, qint32 offCpuCostId);
+
+    int size() const
+    {
+        return m_starts.size();
+    }
+
+    bool isEmpty() const
+    {
+        return m_starts.isEmpty();
+    }
+
+    TimeRange at(int i) const
+    {
+        return {m_starts[i], m_starts[i] + m_blockedTimes[i + 1] - m_blockedTimes[i]};
+    }
+
+    // the index of the latest starting period that overlaps [time.start, time.end), or -1
+    int find(TimeRange time) const;
+
+    // the time spent off-CPU within [time.start, time.end)
+    quint64 blockedTime(TimeRange time) const;
+
+private:
+    // the time spent off-CPU before @p time
+    quint64 blockedTimeBefore(quint64 time) const;
+
+    QVector<quint64> m_starts;
+    // m_blockedTimes[i] is the summed duration of the first i periods, i.e. it has one more entry than m_starts
+    QVector<quint64> m_blockedTimes;
+    // m_maxEnds[i] is the latest end time of the first i + 1 periods, which bounds the search for overlaps
+    QVector<quint64> m_maxEnds;
+};
+
+/**
+ * Multi-resolution summary of the events of a timeline row.
+ *
+ * The time spanned by the events is split into equally sized buckets, every bucket stores the number of
+ * events, their total and their maximum cost per cost type. Each further level merges two buckets of the
+ * level below, which allows summarizing any time range by looking at O(log n) buckets plus the events of
+ * the partially covered buckets at its borders. The off-CPU periods are indexed separately, see
+ * OffCpuIntervals. The timeline uses this to paint and hit test per pixel instead of per event.
+ */
+class EventPyramid
+{
+public:
+    struct Bucket
+    {
+        quint32 numEvents = 0;
+        quint64 totalCost = 0;
+        quint64 maxCost = 0;
+
+        void add(quint64 cost)
+        {
+            ++numEvents;
+            totalCost += cost;
+            maxCost = std::max(maxCost, cost);
+        }
+
+        void add(const Bucket& rhs)
+        {
+            numEvents += rhs.numEvents;
+            totalCost += rhs.totalCost;
+            maxCost = std::max(maxCost, rhs.maxCost);
+        }
+
+        bool operator==(const Bucket& rhs) const
+        {
+            return std::tie(numEvents, totalCost, maxCost) == std::tie(rhs.numEvents, rhs.totalCost, rhs.maxCost);
+        }
+    };
+
+    EventPyramid() = default;
+    EventPyramid(const EventsView& events, int numCostTypes, qint32 offCpuCostId = -1);
+
+    // summarizes the events of @p type whose time lies within [time.start, time.end)
+    Bucket query(qint32 type, TimeRange time) const;
+
+    const EventsView& events() const
+    {
+        return m_events;
+    }
+
+    const OffCpuIntervals& offCpuIntervals() const
+    {
+        return m_offCpuIntervals;
+    }
+
+    // the time spanned by the events
+    TimeRange timeRange() const
+    {
+        return m_time;
+    }
+
+    int numLevels() const
+    {
+        return m_levels.size();
+    }
+
+private:
+    enum : int
+    {
+        EVENTS_PER_BUCKET = 16
+    };
+
+    int bucketIndex(quint64 time) const
+    {
+        return static_cast<int>((time - m_time.start) / m_bucketSize);
+    }
+
+    quint64 bucketStart(int bucket) const
+    {
+        return m_time.start + bucket * m_bucketSize;
+    }
+
+    void addEvents(Bucket* bucket, qint32 type, quint64 start, quint64 end) const;
+
+    EventsView m_events;
+    TimeRange m_time;
+    quint64 m_bucketSize = 1;
+    int m_numCostTypes = 0;
+    // m_levels[level][bucket * m_numCostTypes + type], every level has half the buckets of the one below
+    QVector<QVector<Bucket>> m_levels;
+    OffCpuIntervals m_offCpuIntervals;
+};
+
 struct CostSummary
 {
     CostSummary() = default;
@@ -693,17 +1580,45 @@ struct Summary
     QStringList errors;
 };
 
+// a frame in the prefix tree of all sampled stacks, see EventResults::stacks
+struct StackNode
+{
+    StackNode() = default;
+    StackNode(qint32 parent, qint32 locationId)
+        : parent(parent)
+        , locationId(locationId)
+    {
+    }
+
+    // the node of the calling frame, or -1 for the root
+    qint32 parent = -1;
+    qint32 locationId = -1;
+
+    bool operator==(const StackNode& rhs) const
+    {
+        return std::tie(parent, locationId) == std::tie(rhs.parent, rhs.locationId);
+    }
+};
+
 struct EventResults
 {
     QVector<ThreadEvents> threads;
     QVector<CpuEvents> cpus;
-    QVector<QVector<qint32>> stacks;
+    // prefix tree shared by all stacks, a stack id is the index of the node of its innermost frame
+    // the first node is the root, which stands for the empty stack. parents always precede their children
+    QVector<StackNode> stacks;
     QVector<CostSummary> totalCosts;
     qint32 offCpuTimeCostId = -1;
 
     ThreadEvents* findThread(qint32 pid, qint32 tid);
     const ThreadEvents* findThread(qint32 pid, qint32 tid) const;
 
+    // resolve the events referenced by @p cpu
+    Events eventsForCpu(const CpuEvents& cpu) const;
+
+    // the location ids of the frames of the stack, innermost frame first
+    QVector<qint32> stackFrames(qint32 stackId) const;
+
     bool operator==(const EventResults& rhs) const
     {
         return std::tie(threads, cpus, stacks, totalCosts, offCpuTimeCostId)
@@ -711,6 +1626,71 @@ struct EventResults
     }
 };
 
+// maps pid and tid to the index of a thread in EventResults::threads, such that the parser
+// can look up threads in constant time. when a tid gets reused, the newer thread replaces
+// the older one, just like in EventResults::findThread
+class ThreadIndex
+{
+public:
+    // a thread that reuses the pid and tid of an earlier one takes over from its @p startTime on, see find
+    // the indices have to be inserted in increasing order, like the threads get appended to EventResults
+    void insert(qint32 pid, qint32 tid, quint64 startTime, qint32 index)
+    {
+        const auto previous = find(pid, tid);
+        m_latest.insert(key(pid, tid), index);
+        if (m_generations.size() <= index)
+            m_generations.resize(index + 1);
+        m_generations[index] = {startTime, previous};
+    }
+
+    // returns the index of the thread that was alive at @p time, or -1 when no such thread is known
+    // events before the start of the first thread with these ids still resolve to that one
+    qint32 find(qint32 pid, qint32 tid, quint64 time) const
+    {
+        auto index = m_latest.value(key(pid, tid), -1);
+        while (index != -1) {
+            const auto& generation = m_generations[index];
+            if (generation.startTime <= time || generation.previous == -1)
+                break;
+            index = generation.previous;
+        }
+        return index;
+    }
+
+    // returns the index of the newest thread with these ids, or -1 when no such thread is known
+    qint32 find(qint32 pid, qint32 tid) const
+    {
+        return m_latest.value(key(pid, tid), -1);
+    }
+
+    int size() const
+    {
+        return m_latest.size();
+    }
+
+    void clear()
+    {
+        m_latest.clear();
+        m_generations.clear();
+    }
+
+private:
+    static quint64 key(qint32 pid, qint32 tid)
+    {
+        return (quint64(quint32(pid)) << 32) | quint32(tid);
+    }
+
+    struct Generation
+    {
+        quint64 startTime;
+        // the index of the earlier thread with the same ids, or -1
+        qint32 previous;
+    };
+
+    QHash<quint64, qint32> m_latest;
+    QVector<Generation> m_generations;
+};
+
 struct FilterAction
 {
     TimeRange time;
@@ -731,8 +1711,22 @@ struct FilterAction
             || !excludeCpuIds.isEmpty() || !includeSymbols.isEmpty()
             || !excludeSymbols.isEmpty();
     }
+
+    // true when everything that passes this filter also passes @p base
+    // i.e. this filter can be applied to the results of @p base instead of the full data
+    bool isRefinementOf(const FilterAction& base) const;
 };
 
+// filters are compared and hashed in their canonical form, i.e. ignoring the order of the excluded ids
+bool operator==(const FilterAction& lhs, const FilterAction& rhs);
+
+inline bool operator!=(const FilterAction& lhs, const FilterAction& rhs)
+{
+    return !(lhs == rhs);
+}
+
+uint qHash(const FilterAction& filter, uint seed = 0);
+
 struct ZoomAction
 {
     TimeRange time;
@@ -742,6 +1736,21 @@ struct ZoomAction
         return time.isValid();
     }
 };
+
+/**
+ * Immutable results as published by the parser.
+ *
+ * The snapshot is reference counted and gets shared by all pages, models and background jobs,
+ * no one copies the results themselves. The data must not be changed after it got published.
+ */
+template<typename Results>
+using Snapshot = QSharedPointer<const Results>;
+
+template<typename Results>
+Snapshot<Results> makeSnapshot(Results results)
+{
+    return Snapshot<Results>(new Results(std::move(results)));
+}
 }
 
 Q_DECLARE_METATYPE(Data::Symbol)
@@ -779,6 +1788,22 @@ Q_DECLARE_TYPEINFO(Data::CallerCalleeResults, Q_MOVABLE_TYPE);
 Q_DECLARE_METATYPE(Data::Event)
 Q_DECLARE_TYPEINFO(Data::Event, Q_MOVABLE_TYPE);
 
+Q_DECLARE_METATYPE(Data::Events)
+Q_DECLARE_TYPEINFO(Data::Events, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::EventsView, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::OffCpuIntervals, Q_MOVABLE_TYPE);
+
+Q_DECLARE_METATYPE(Data::EventPyramid)
+Q_DECLARE_TYPEINFO(Data::EventPyramid, Q_MOVABLE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::EventIndex, Q_PRIMITIVE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::StackNode, Q_PRIMITIVE_TYPE);
+
+Q_DECLARE_TYPEINFO(Data::FlatBottomUp::Node, Q_PRIMITIVE_TYPE);
+
 Q_DECLARE_METATYPE(Data::ThreadEvents)
 Q_DECLARE_TYPEINFO(Data::ThreadEvents, Q_MOVABLE_TYPE);
 
@@ -794,6 +1819,11 @@ Q_DECLARE_TYPEINFO(Data::CostSummary, Q_MOVABLE_TYPE);
 Q_DECLARE_METATYPE(Data::EventResults)
 Q_DECLARE_TYPEINFO(Data::EventResults, Q_MOVABLE_TYPE);
 
+Q_DECLARE_METATYPE(Data::Snapshot<Data::BottomUpResults>)
+Q_DECLARE_METATYPE(Data::Snapshot<Data::TopDownResults>)
+Q_DECLARE_METATYPE(Data::Snapshot<Data::CallerCalleeResults>)
+Q_DECLARE_METATYPE(Data::Snapshot<Data::EventResults>)
+
 Q_DECLARE_METATYPE(Data::TimeRange)
 Q_DECLARE_TYPEINFO(Data::TimeRange, Q_MOVABLE_TYPE);
 
@@ -32,11 +32,6 @@
 #include <QDebug>
 #include <QSet>
 
-static bool operator<(const EventModel::Process &process, qint32 pid)
-{
-    return process.pid < pid;
-}
-
 namespace {
 enum class Tag : quint8
 {
@@ -80,6 +75,7 @@ quintptr tagData(quintptr internalId)
 
 EventModel::EventModel(QObject* parent)
     : QAbstractItemModel(parent)
+    , m_data(Data::makeSnapshot(Data::EventResults()))
 {
 }
 
@@ -101,9 +97,9 @@ int EventModel::rowCount(const QModelIndex& parent) const
     case Tag::Threads:
         break;
     case Tag::Processes:
-        return m_processes.value(parent.row()).threads.size();
+        return m_processes.at(parent.row()).threads.size();
     case Tag::Overview:
-        return (parent.row() == 0) ? m_data.cpus.size() : m_processes.size();
+        return (parent.row() == 0) ? m_cpus.size() : m_processes.size();
     case Tag::Root:
         return 2;
     };
@@ -142,15 +138,17 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
     } else if (role == MinTimeRole) {
         return m_time.start;
     } else if (role == MaxCostRole) {
-        return m_maxCost;
+        return m_maxCosts.value(0);
+    } else if (role == MaxCostsRole) {
+        return QVariant::fromValue(m_maxCosts);
     } else if (role == NumProcessesRole) {
         return m_processes.size();
     } else if (role == NumThreadsRole) {
-        return m_data.threads.size();
+        return m_data->threads.size();
     } else if (role == NumCpusRole) {
-        return static_cast<uint>(m_data.cpus.size());
+        return static_cast<uint>(m_cpus.size());
     } else if (role == TotalCostsRole) {
-        return QVariant::fromValue(m_data.totalCosts);
+        return QVariant::fromValue(m_data->totalCosts);
     } else if (role == EventResultsRole) {
         return QVariant::fromValue(m_data);
     }
@@ -174,7 +172,7 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
         }
         return {};
     } else if (tag == Tag::Processes) {
-        const auto &process = m_processes.value(index.row());
+        const auto& process = m_processes.at(index.row());
         if (role == Qt::DisplayRole)
             return tr("%1 (#%2)").arg(process.name, QString::number(process.pid));
         else if (role == SortRole)
@@ -184,18 +182,10 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
             QString tooltip = tr("Process %1, pid = %2, num threads = %3\n")
                                         .arg(process.name, QString::number(process.pid), QString::number(process.threads.size()));
 
-            quint64 runtime = 0;
-            quint64 maxRuntime = 0;
-            quint64 offCpuTime = 0;
-            quint64 numEvents = 0;
-            for (const auto tid : process.threads) {
-                const auto thread = m_data.findThread(process.pid, tid);
-                Q_ASSERT(thread);
-                runtime += thread->time.delta();
-                maxRuntime = std::max(thread->time.delta(), maxRuntime);
-                offCpuTime += thread->offCpuTime;
-                numEvents += thread->events.size();
-            }
+            const auto runtime = process.runtime;
+            const auto maxRuntime = process.maxRuntime;
+            const auto offCpuTime = process.offCpuTime;
+            const auto numEvents = process.numEvents;
 
             const auto totalRuntime = m_time.delta();
             tooltip += tr("Runtime: %1 (%2% of total runtime)\n")
@@ -222,15 +212,14 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
 
     const Data::ThreadEvents* thread = nullptr;
     const Data::CpuEvents* cpu = nullptr;
+    int threadIndex = -1;
 
     if (tag == Tag::Cpus) {
-        cpu = &m_data.cpus[index.row()];
+        cpu = &m_cpus[index.row()];
     } else {
         Q_ASSERT(tag == Tag::Threads);
-        const auto process = m_processes.value(tagData(index.internalId()));
-        const auto tid = process.threads.value(index.row());
-        thread = m_data.findThread(process.pid, tid);
-        Q_ASSERT(thread);
+        threadIndex = m_processes.at(tagData(index.internalId())).threads.at(index.row());
+        thread = &m_data->threads[threadIndex];
     }
 
     if (role == ThreadStartRole) {
@@ -246,7 +235,10 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
     } else if (role == CpuIdRole) {
         return cpu ? cpu->cpuId : Data::INVALID_CPU_ID;
     } else if (role == EventsRole) {
-        return QVariant::fromValue(thread ? thread->events : cpu->events);
+        // the cpus only reference the thread events, this resolves a copy of them
+        return QVariant::fromValue(thread ? thread->events : m_data->eventsForCpu(*cpu));
+    } else if (role == EventPyramidRole) {
+        return QVariant::fromValue(thread ? threadPyramid(threadIndex) : cpuPyramid(index.row()));
     } else if (role == SortRole) {
         if (index.column() == ThreadColumn)
             return thread ? thread->tid : cpu->cpuId;
@@ -297,48 +289,69 @@ QVariant EventModel::data(const QModelIndex& index, int role) const
 }
 
 void EventModel::setData(const Data::EventResults& data)
+{
+    setData(Data::makeSnapshot(data));
+}
+
+void EventModel::setData(const Data::Snapshot<Data::EventResults>& data)
 {
     beginResetModel();
     m_data = data;
+    m_cpus.clear();
     m_totalEvents = 0;
-    m_maxCost = 0;
+    m_maxCosts.fill(0, data->totalCosts.size());
     m_processes.clear();
     m_totalOnCpuTime = 0;
     m_totalOffCpuTime = 0;
-    if (data.threads.isEmpty()) {
+    if (data->threads.isEmpty()) {
         m_time = {};
     } else {
-        m_time = data.threads.first().time;
-        for (const auto& thread : data.threads) {
+        m_time = data->threads.first().time;
+        // index of the process in m_processes by its pid
+        QHash<qint32, int> processIndices;
+        processIndices.reserve(data->threads.size());
+        for (int threadIndex = 0, numThreads = data->threads.size(); threadIndex < numThreads; ++threadIndex) {
+            const auto& thread = data->threads[threadIndex];
             m_time.start = std::min(thread.time.start, m_time.start);
             m_time.end = std::max(thread.time.end, m_time.end);
             m_totalOffCpuTime += thread.offCpuTime;
             m_totalOnCpuTime += thread.time.delta() - thread.offCpuTime;
             m_totalEvents += thread.events.size();
-            auto it = std::lower_bound(m_processes.begin(), m_processes.end(), thread.pid);
-            if (it == m_processes.end() || it->pid != thread.pid) {
-                m_processes.insert(it, {thread.pid, {thread.tid}, thread.name});
-            } else {
-                it->threads.append(thread.tid);
+
+            auto it = processIndices.find(thread.pid);
+            if (it == processIndices.end()) {
+                it = processIndices.insert(thread.pid, m_processes.size());
+                m_processes.append({thread.pid, thread.name});
+            } else if (thread.pid == thread.tid) {
                 // prefer process name, if we encountered a thread first
-                if (thread.pid == thread.tid)
-                    it->name = thread.name;
+                m_processes[*it].name = thread.name;
             }
-
-            for (const auto& event : thread.events) {
-                if (event.type != 0) {
-                    // TODO: support multiple cost types somehow
-                    continue;
-                }
-                m_maxCost = std::max(event.cost, m_maxCost);
+            auto& process = m_processes[*it];
+            process.threads.append(threadIndex);
+            process.runtime += thread.time.delta();
+            process.maxRuntime = std::max(thread.time.delta(), process.maxRuntime);
+            process.offCpuTime += thread.offCpuTime;
+            process.numEvents += thread.events.size();
+
+            for (int i = 0, c = thread.events.size(); i < c; ++i) {
+                const auto type = thread.events.type(i);
+                if (type >= 0 && type < m_maxCosts.size())
+                    m_maxCosts[type] = std::max(thread.events.cost(i), m_maxCosts[type]);
             }
         }
 
+        std::sort(m_processes.begin(), m_processes.end(),
+                  [](const Process& lhs, const Process& rhs) { return lhs.pid < rhs.pid; });
+
         // don't show timeline for CPU cores that did not receive any events
-        auto it = std::remove_if(m_data.cpus.begin(), m_data.cpus.end(),
-                                 [](const Data::CpuEvents& cpuEvents) { return cpuEvents.events.isEmpty(); });
-        m_data.cpus.erase(it, m_data.cpus.end());
+        std::copy_if(data->cpus.begin(), data->cpus.end(), std::back_inserter(m_cpus),
+                     [](const Data::CpuEvents& cpuEvents) { return !cpuEvents.events.isEmpty(); });
     }
+
+    m_threadPyramids.clear();
+    m_threadPyramids.resize(data->threads.size());
+    m_cpuPyramids.clear();
+    m_cpuPyramids.resize(m_cpus.size());
     endResetModel();
 }
 
@@ -347,6 +360,24 @@ Data::TimeRange EventModel::timeRange() const
     return m_time;
 }
 
+const Data::EventPyramid& EventModel::threadPyramid(int thread) const
+{
+    auto& pyramid = m_threadPyramids[thread];
+    const auto& events = m_data->threads[thread].events;
+    if (pyramid.events().isEmpty() && !events.isEmpty())
+        pyramid = {events, m_data->totalCosts.size(), m_data->offCpuTimeCostId};
+    return pyramid;
+}
+
+const Data::EventPyramid& EventModel::cpuPyramid(int cpu) const
+{
+    auto& pyramid = m_cpuPyramids[cpu];
+    const auto& events = m_cpus[cpu].events;
+    if (pyramid.events().isEmpty() && !events.isEmpty())
+        pyramid = {Data::EventsView(m_data->threads, events), m_data->totalCosts.size(), m_data->offCpuTimeCostId};
+    return pyramid;
+}
+
 QModelIndex EventModel::index(int row, int column, const QModelIndex& parent) const
 {
     if (row < 0 || row >= rowCount(parent) || column < 0 || column >= NUM_COLUMNS) {
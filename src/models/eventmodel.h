@@ -62,6 +62,8 @@ public:
         SortRole,
         TotalCostsRole,
         EventResultsRole,
+        EventPyramidRole,
+        MaxCostsRole,
     };
 
     int rowCount(const QModelIndex& parent = {}) const override;
@@ -74,29 +76,49 @@ public:
     QModelIndex parent(const QModelIndex& child) const override;
 
     using QAbstractItemModel::setData;
+    void setData(const Data::Snapshot<Data::EventResults>& data);
     void setData(const Data::EventResults& data);
 
     Data::TimeRange timeRange() const;
 
     struct Process
     {
-        Process(qint32 pid = Data::INVALID_PID, const QVector<qint32> threads = {}, const QString &name = {})
+        Process(qint32 pid = Data::INVALID_PID, const QString& name = {})
             : pid(pid)
-            , threads(threads)
             , name(name)
-        {}
+        {
+        }
         qint32 pid;
-        QVector<qint32> threads;
+        // indices into EventResults::threads, in the order in which the threads were encountered
+        QVector<int> threads;
         QString name;
+        // aggregated once when the data is set, so that tooltips don't have to iterate over the threads
+        quint64 runtime = 0;
+        quint64 maxRuntime = 0;
+        quint64 offCpuTime = 0;
+        quint64 numEvents = 0;
     };
+
 private:
-    Data::EventResults m_data;
+    // the pyramids are built on demand, usually only a few rows are visible in the timeline at once
+    const Data::EventPyramid& threadPyramid(int thread) const;
+    const Data::EventPyramid& cpuPyramid(int cpu) const;
+
+    Data::Snapshot<Data::EventResults> m_data;
+    // the cpus that received any events, the snapshot itself is immutable
+    QVector<Data::CpuEvents> m_cpus;
+    // summaries of the events for the timeline, indexed like m_data->threads and m_cpus respectively
+    // the cpu pyramids read the events through the indices of the cpus, instead of copying them
+    mutable QVector<Data::EventPyramid> m_threadPyramids;
+    mutable QVector<Data::EventPyramid> m_cpuPyramids;
+    // sorted by pid
     QVector<Process> m_processes;
     Data::TimeRange m_time;
     quint64 m_totalOnCpuTime = 0;
     quint64 m_totalOffCpuTime = 0;
     quint64 m_totalEvents = 0;
-    quint64 m_maxCost = 0;
+    // the maximum cost of a single event, per cost type
+    QVector<quint64> m_maxCosts;
 };
 
 Q_DECLARE_TYPEINFO(EventModel::Process, Q_MOVABLE_TYPE);
@@ -40,6 +40,7 @@
 #include "filterandzoomstack.h"
 
 #include <KColorScheme>
+#include <ThreadWeaver/ThreadWeaver>
 
 #include <algorithm>
 
@@ -48,9 +49,9 @@ TimeLineData::TimeLineData()
 {
 }
 
-TimeLineData::TimeLineData(const Data::Events& events, quint64 maxCost, const Data::TimeRange& time,
+TimeLineData::TimeLineData(const Data::EventPyramid& pyramid, quint64 maxCost, const Data::TimeRange& time,
                            const Data::TimeRange& threadTime, QRect rect)
-    : events(events)
+    : pyramid(pyramid)
     , maxCost(maxCost)
     , time(time)
     , threadTime(threadTime)
@@ -71,6 +72,11 @@ quint64 TimeLineData::mapXToTime(int x) const
     return quint64(double(x) / xMultiplicator) + time.start;
 }
 
+Data::TimeRange TimeLineData::mapXToTimeRange(int x) const
+{
+    return {mapXToTime(x), mapXToTime(x + 1)};
+}
+
 int TimeLineData::mapCostToY(quint64 cost) const
 {
     return double(cost) * yMultiplicator;
@@ -84,10 +90,11 @@ void TimeLineData::zoom(const Data::TimeRange& t)
 
 namespace {
 
-TimeLineData dataFromIndex(const QModelIndex& index, QRect rect, const Data::ZoomAction &zoom)
+TimeLineData dataFromIndex(const QModelIndex& index, QRect rect, const Data::ZoomAction& zoom, int eventType)
 {
     TimeLineData data(
-        index.data(EventModel::EventsRole).value<Data::Events>(), index.data(EventModel::MaxCostRole).value<quint64>(),
+        index.data(EventModel::EventPyramidRole).value<Data::EventPyramid>(),
+        index.data(EventModel::MaxCostsRole).value<QVector<quint64>>().value(eventType),
         {index.data(EventModel::MinTimeRole).value<quint64>(), index.data(EventModel::MaxTimeRole).value<quint64>()},
         {index.data(EventModel::ThreadStartRole).value<quint64>(),
          index.data(EventModel::ThreadEndRole).value<quint64>()},
@@ -103,6 +110,86 @@ Data::Events::const_iterator findEvent(Data::Events::const_iterator begin, Data:
 {
     return std::lower_bound(begin, end, time, [](const Data::Event& event, quint64 time) { return event.time < time; });
 }
+
+struct TileColors
+{
+    QColor running;
+    QColor runningOutline;
+    QColor samples;
+    QColor offCpu;
+};
+
+void paintTile(QPainter* painter, const TimeLineData& data, const TileColors& colors, int eventType, QSize size)
+{
+    // account for padding
+    painter->translate(data.padding, data.padding);
+
+    // visualize the time where the thread was active
+    // i.e. paint events for threads that have any in the selected time range
+    auto threadTimeRect =
+        QRect(QPoint(data.mapTimeToX(data.threadTime.start), 0), QPoint(data.mapTimeToX(data.threadTime.end), data.h));
+    if (threadTimeRect.left() >= size.width() || threadTimeRect.right() <= 0) {
+        return;
+    }
+    if (threadTimeRect.left() < 0)
+        threadTimeRect.setLeft(0);
+    if (threadTimeRect.right() > size.width())
+        threadTimeRect.setRight(size.width());
+
+    painter->setBrush(QBrush(colors.running));
+    painter->setPen(QPen(colors.runningOutline, 1));
+    painter->drawRect(threadTimeRect.adjusted(-1, -1, 0, 0));
+
+    // visualize all events, one pixel column at a time. the pyramid summarizes the events of a column
+    // without looking at all of them, which keeps painting independent of the number of events
+    painter->setPen(QPen(colors.samples, 1));
+    painter->setBrush({});
+    const auto firstX = std::max(threadTimeRect.left(), 0);
+    const auto lastX = std::min(threadTimeRect.right(), data.w - 1);
+
+    const auto& offCpuIntervals = data.pyramid.offCpuIntervals();
+    if (!offCpuIntervals.isEmpty()) {
+        for (int x = firstX; x <= lastX; ++x) {
+            const auto pixelTime = data.mapXToTimeRange(x);
+            const auto offCpuTime = offCpuIntervals.blockedTime(pixelTime);
+            if (!offCpuTime || pixelTime.isEmpty()) {
+                continue;
+            }
+
+            // columns that are only partially off-CPU get painted more transparent
+            auto color = colors.offCpu;
+            color.setAlphaF(std::min(1., double(offCpuTime) / pixelTime.delta()));
+            painter->fillRect(x, 0, 1, data.h, color);
+        }
+    }
+
+    // the height of a column shows the maximum cost of a single event within it, which keeps the y scale
+    // in sync across all delegates. note that in frequency mode (perf record -F vs. perf record -c) the cost
+    // of the individual samples varies, see also: https://www.spinics.net/lists/linux-perf-users/msg03486.html
+    for (int x = firstX; x <= lastX; ++x) {
+        const auto found = data.pyramid.query(eventType, data.mapXToTimeRange(x));
+        if (!found.numEvents) {
+            continue;
+        }
+
+        const auto height = data.maxCost ? std::min(std::max(data.mapCostToY(found.maxCost), 1), data.h) : data.h;
+        painter->drawLine(x, data.h - height, x, data.h);
+    }
+}
+
+// renders the events of a row into a transparent image, this is safe to call from a background thread
+QImage renderTile(const TimeLineData& data, const TileColors& colors, int eventType, QSize size,
+                  qreal devicePixelRatio)
+{
+    QImage image(size * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(devicePixelRatio);
+    image.fill(Qt::transparent);
+
+    QPainter painter(&image);
+    paintTile(&painter, data, colors, eventType, size);
+    painter.end();
+    return image;
+}
 }
 
 TimeLineDelegate::TimeLineDelegate(FilterAndZoomStack* filterAndZoomStack, QAbstractItemView* view)
@@ -112,7 +199,13 @@ TimeLineDelegate::TimeLineDelegate(FilterAndZoomStack* filterAndZoomStack, QAbst
 {
     m_view->viewport()->installEventFilter(this);
 
-    connect(filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, &TimeLineDelegate::updateView);
+    // the cost of a tile is its size in KiB, this is enough for a few hundred rows on a large screen
+    m_tiles.setMaxCost(256 * 1024);
+
+    connect(filterAndZoomStack, &FilterAndZoomStack::filterChanged, this, [this]() {
+        invalidateTiles();
+        updateView();
+    });
     connect(filterAndZoomStack, &FilterAndZoomStack::zoomChanged, this, &TimeLineDelegate::updateZoomState);
 }
 
@@ -120,88 +213,42 @@ TimeLineDelegate::~TimeLineDelegate() = default;
 
 void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
-    const auto data = dataFromIndex(index, option.rect, m_filterAndZoomStack->zoom());
-    const auto offCpuCostId = index.data(EventModel::EventResultsRole).value<Data::EventResults>().offCpuTimeCostId;
+    const auto data = dataFromIndex(index, option.rect, m_filterAndZoomStack->zoom(), m_eventType);
+    const auto results = index.data(EventModel::EventResultsRole).value<Data::Snapshot<Data::EventResults>>();
     const bool is_alternate = option.features & QStyleOptionViewItem::Alternate;
     const auto& palette = option.palette;
 
     painter->fillRect(option.rect, is_alternate ? palette.base() : palette.alternateBase());
 
-    // skip threads that are outside the visible (zoomed) region
-    painter->save();
-
-    // transform into target coordinate system
-    painter->translate(option.rect.topLeft());
-    // account for padding
-    painter->translate(data.padding, data.padding);
-
-    // visualize the time where the thread was active
-    // i.e. paint events for threads that have any in the selected time range
-    auto threadTimeRect =
-        QRect(QPoint(data.mapTimeToX(data.threadTime.start), 0), QPoint(data.mapTimeToX(data.threadTime.end), data.h));
-    if (threadTimeRect.left() < option.rect.width() && threadTimeRect.right() > 0) {
-        if (threadTimeRect.left() < 0)
-            threadTimeRect.setLeft(0);
-        if (threadTimeRect.right() > option.rect.width())
-            threadTimeRect.setRight(option.rect.width());
-
-        KColorScheme scheme(palette.currentColorGroup());
-
-        auto runningColor = scheme.background(KColorScheme::PositiveBackground).color();
-        runningColor.setAlpha(128);
-        auto runningOutlineColor = scheme.foreground(KColorScheme::PositiveText).color();
-        runningOutlineColor.setAlpha(128);
-        painter->setBrush(QBrush(runningColor));
-        painter->setPen(QPen(runningOutlineColor, 1));
-        painter->drawRect(threadTimeRect.adjusted(-1, -1, 0, 0));
-
-        // visualize all events
-        QPen pen(scheme.foreground(KColorScheme::NeutralText), 1);
-        painter->setPen(pen);
-        painter->setBrush({});
-        auto offCpuColor = scheme.background(KColorScheme::NegativeBackground).color();
-
-        if (offCpuCostId != -1) {
-            for (const auto& event : data.events) {
-                if (event.type != offCpuCostId) {
-                    continue;
-                }
-
-                const auto x = data.mapTimeToX(event.time);
-                const auto x2 = data.mapTimeToX(event.time + event.cost);
-                painter->fillRect(x, 0, x2 - x, data.h, offCpuColor);
-            }
-        }
-
-        int last_x = -1;
-        // TODO: accumulate cost for events that fall to the same pixel somehow
-        // but how to then sync the y scale across different delegates?
-        // somehow deduce threshold via min time delta and max cost?
-        // TODO: how to deal with broken cycle counts in frequency mode? For now,
-        // we simply always fill the complete height which is also what we'd get
-        // from a graph in count mode (perf record -F vs. perf record -c)
-        // see also: https://www.spinics.net/lists/linux-perf-users/msg03486.html
-        for (const auto& event : data.events) {
-            if (event.type != m_eventType) {
-                continue;
-            }
-
-            const auto x = data.mapTimeToX(event.time);
-            if (x < data.padding || x >= data.w) {
-                continue;
-            }
-
-            // only draw a line when it changes anything visually
-            if (x != last_x) {
-                painter->drawLine(x, 0, x, data.h);
-            }
+    if (results != m_tileResults) {
+        // new data got set, e.g. after filtering or while analyzing live
+        m_tileResults = results;
+        invalidateTiles();
+    }
 
-            last_x = x;
-        }
+    TileKey key;
+    key.processId = index.data(EventModel::ProcessIdRole).value<qint32>();
+    key.threadId = index.data(EventModel::ThreadIdRole).value<qint32>();
+    key.cpuId = index.data(EventModel::CpuIdRole).value<quint32>();
+    key.time = data.time;
+    key.threadTime = data.threadTime;
+    key.eventType = m_eventType;
+    key.size = option.rect.size();
+    key.devicePixelRatio = m_view->viewport()->devicePixelRatioF();
+
+    if (const auto* tile = m_tiles.object(key)) {
+        painter->drawImage(option.rect.topLeft(), *tile);
+    } else if (!m_pendingTiles.contains(key)) {
+        requestTile(key, data, palette);
     }
 
     if (m_timeSlice.isValid()) {
-        // the painter is translated to option.rect.topLeft
+        painter->save();
+        // transform into target coordinate system
+        painter->translate(option.rect.topLeft());
+        // account for padding
+        painter->translate(data.padding, data.padding);
+
         // clamp to available width to prevent us from painting over the other columns
         const auto startX = std::max(data.mapTimeToX(m_timeSlice.normalized().start), 0);
         const auto endX = std::min(data.mapTimeToX(m_timeSlice.normalized().end), data.w);
@@ -213,82 +260,78 @@ void TimeLineDelegate::paint(QPainter* painter, const QStyleOptionViewItem& opti
         color.setAlpha(128);
         brush.setColor(color);
         painter->fillRect(timeSlice, brush);
+        painter->restore();
     }
+}
 
-    painter->restore();
+void TimeLineDelegate::requestTile(const TileKey& key, const TimeLineData& data, const QPalette& palette) const
+{
+    m_pendingTiles.insert(key);
+
+    // KColorScheme must only be used in the GUI thread
+    KColorScheme scheme(palette.currentColorGroup());
+    TileColors colors;
+    colors.running = scheme.background(KColorScheme::PositiveBackground).color();
+    colors.running.setAlpha(128);
+    colors.runningOutline = scheme.foreground(KColorScheme::PositiveText).color();
+    colors.runningOutline.setAlpha(128);
+    colors.samples = scheme.foreground(KColorScheme::NeutralText).color();
+    colors.offCpu = scheme.background(KColorScheme::NegativeBackground).color();
+
+    using namespace ThreadWeaver;
+    const auto generation = m_tileGeneration;
+    auto* view = m_view;
+    stream() << make_job([this, view, key, data, colors, generation]() {
+        const auto tile = renderTile(data, colors, key.eventType, key.size, key.devicePixelRatio);
+        QMetaObject::invokeMethod(
+            view,
+            [this, view, key, tile, generation]() {
+                if (generation != m_tileGeneration) {
+                    return;
+                }
+                m_pendingTiles.remove(key);
+                m_tiles.insert(key, new QImage(tile), std::max(1, static_cast<int>(tile.sizeInBytes() / 1024)));
+                view->viewport()->update();
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+void TimeLineDelegate::invalidateTiles() const
+{
+    m_tiles.clear();
+    m_pendingTiles.clear();
+    ++m_tileGeneration;
 }
 
 bool TimeLineDelegate::helpEvent(QHelpEvent* event, QAbstractItemView* view, const QStyleOptionViewItem& option,
                                  const QModelIndex& index)
 {
     if (event->type() == QEvent::ToolTip) {
-        const auto data = dataFromIndex(index, option.rect, m_filterAndZoomStack->zoom());
+        const auto data = dataFromIndex(index, option.rect, m_filterAndZoomStack->zoom(), m_eventType);
         const auto localX = event->pos().x();
         const auto mappedX = localX - option.rect.x() - data.padding;
-        const auto time = data.mapXToTime(mappedX);
-        const auto start = findEvent(data.events.constBegin(), data.events.constEnd(), time);
-        // find the maximum sample cost in the range spanned by one pixel
-        struct FoundSamples
-        {
-            uint numSamples = 0;
-            quint64 maxCost = 0;
-            quint64 totalCost = 0;
-            int type = -1;
-        };
-        auto findSamples = [&](int costType, bool contains) -> FoundSamples {
-            FoundSamples ret;
-            ret.type = costType;
-            auto it = start;
-            if (contains) {
-                // for a contains check, we must only include events for the correct type
-                // otherwise we might skip the sched switch e.g.
-                while (it->type != costType && it != data.events.constBegin()) {
-                    --it;
-                }
-            }
-            while (it != data.events.constEnd()) {
-                if (it->type != costType) {
-                    ++it;
-                    continue;
-                }
-                const auto timeX = data.mapTimeToX(it->time);
-                if (timeX > mappedX) {
-                    // event lies to the right of the selected time
-                    break;
-                } else if (contains && mappedX > data.mapTimeToX(it->time + it->cost)) {
-                    // event lies to the left of the selected time
-                    ++it;
-                    continue;
-                }
-                Q_ASSERT(contains || mappedX == timeX);
-                ++ret.numSamples;
-                ret.maxCost = std::max(ret.maxCost, it->cost);
-                ret.totalCost += it->cost;
-                ++it;
-            }
-            return ret;
-        };
-        auto found = findSamples(m_eventType, false);
-        const auto offCpuCostId = index.data(EventModel::EventResultsRole).value<Data::EventResults>().offCpuTimeCostId;
-        if (offCpuCostId != -1 && !found.numSamples) {
-            // check whether we are hovering an off-CPU area
-            found = findSamples(offCpuCostId, true);
-        }
+        const auto pixelTime = data.mapXToTimeRange(mappedX);
+        const auto time = pixelTime.start;
+        const auto found = data.pyramid.query(m_eventType, pixelTime);
+        // when no samples are hovered, check whether we are hovering an off-CPU period instead
+        const auto& offCpuIntervals = data.pyramid.offCpuIntervals();
+        const auto offCpuIndex = found.numEvents ? -1 : offCpuIntervals.find(pixelTime);
 
         const auto formattedTime = Util::formatTimeString(time - data.time.start);
         const auto totalCosts = index.data(EventModel::TotalCostsRole).value<QVector<Data::CostSummary>>();
-        if (found.numSamples > 0 && found.type == offCpuCostId) {
-            QToolTip::showText(event->globalPos(),
-                               tr("time: %1\nsched switches: %2\ntotal off-CPU time: %3\nlongest sched switch: %4")
-                                   .arg(formattedTime, QString::number(found.numSamples),
-                                        Util::formatTimeString(found.totalCost),
-                                        Util::formatTimeString(found.maxCost)));
-        } else if (found.numSamples > 0) {
+        if (found.numEvents > 0) {
             QToolTip::showText(event->globalPos(),
                                tr("time: %1\n%5 samples: %2\ntotal sample cost: %3\nmax sample cost: %4")
-                                   .arg(formattedTime, QString::number(found.numSamples),
+                                   .arg(formattedTime, QString::number(found.numEvents),
                                         Util::formatCost(found.totalCost), Util::formatCost(found.maxCost),
-                                        totalCosts.value(found.type).label));
+                                        totalCosts.value(m_eventType).label));
+        } else if (offCpuIndex != -1) {
+            const auto offCpuTime = offCpuIntervals.at(offCpuIndex);
+            QToolTip::showText(event->globalPos(),
+                               tr("time: %1\nsched switch at: %2\noff-CPU time: %3")
+                                   .arg(formattedTime, Util::formatTimeString(offCpuTime.start - data.time.start),
+                                        Util::formatTimeString(offCpuTime.delta())));
         } else {
             QToolTip::showText(event->globalPos(),
                                tr("time: %1 (no %2 samples)").arg(formattedTime, totalCosts.value(m_eventType).label));
@@ -327,7 +370,7 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
     const bool isFiltered = filter.isValid();
 
     if (isLeftButtonEvent && inEventsColumn) {
-        const auto data = dataFromIndex(alwaysValidIndex, visualRect, zoom);
+        const auto data = dataFromIndex(alwaysValidIndex, visualRect, zoom, m_eventType);
         const auto time = data.mapXToTime(pos.x() - visualRect.left() - data.padding);
 
         if (isButtonPress) {
@@ -439,13 +482,26 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
         contextMenu->popup(mouseEvent->globalPos());
         return true;
     } else if (isTimeSpanSelected && isLeftButtonEvent) {
-        const auto& data = alwaysValidIndex.data(EventModel::EventResultsRole).value<Data::EventResults>();
+        const auto results =
+            alwaysValidIndex.data(EventModel::EventResultsRole).value<Data::Snapshot<Data::EventResults>>();
+        const auto& data = *results;
         const auto timeDelta = timeSlice.delta();
         quint64 cost = 0;
         quint64 numEvents = 0;
+        quint64 runtime = 0;
+        quint64 blockedTime = 0;
         QSet<qint32> threads;
         QSet<qint32> processes;
         for (const auto& thread : data.threads) {
+            // only the threads that ran during the selection can contribute to it
+            const auto runStart = std::max(thread.time.start, timeSlice.start);
+            const auto runEnd = std::min(thread.time.end, timeSlice.end);
+            if (runStart >= runEnd) {
+                continue;
+            }
+            runtime += runEnd - runStart;
+            blockedTime += Data::blockedTimeInRange(thread.events, data.offCpuTimeCostId, {runStart, runEnd});
+
             const auto start = findEvent(thread.events.begin(), thread.events.end(), timeSlice.start);
             const auto end = findEvent(start, thread.events.end(), timeSlice.end);
             if (start != end) {
@@ -461,14 +517,18 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
             }
         }
 
-        QToolTip::showText(mouseEvent->globalPos(),
-                           tr("ΔT: %1\n"
-                              "Events: %2 (%3) from %4 thread(s), %5 process(es)\n"
-                              "sum of %6: %7 (%8)")
-                               .arg(Util::formatTimeString(timeDelta), Util::formatCost(numEvents),
-                                    Util::formatFrequency(numEvents, timeDelta), QString::number(threads.size()),
-                                    QString::number(processes.size()), data.totalCosts.value(m_eventType).label,
-                                    Util::formatCost(cost), Util::formatFrequency(cost, timeDelta)),
+        auto text = tr("ΔT: %1\n"
+                       "Events: %2 (%3) from %4 thread(s), %5 process(es)\n"
+                       "sum of %6: %7 (%8)")
+                        .arg(Util::formatTimeString(timeDelta), Util::formatCost(numEvents),
+                             Util::formatFrequency(numEvents, timeDelta), QString::number(threads.size()),
+                             QString::number(processes.size()), data.totalCosts.value(m_eventType).label,
+                             Util::formatCost(cost), Util::formatFrequency(cost, timeDelta));
+        if (data.offCpuTimeCostId != -1) {
+            text += tr("\nblocked time: %1 (%2% of the combined thread runtime)")
+                        .arg(Util::formatTimeString(blockedTime), Util::formatCostRelative(blockedTime, runtime));
+        }
+        QToolTip::showText(mouseEvent->globalPos(), text,
                            m_view);
     }
 
@@ -478,6 +538,7 @@ bool TimeLineDelegate::eventFilter(QObject* watched, QEvent* event)
 void TimeLineDelegate::setEventType(int type)
 {
     m_eventType = type;
+    invalidateTiles();
     updateView();
 }
 
@@ -489,5 +550,6 @@ void TimeLineDelegate::updateView()
 void TimeLineDelegate::updateZoomState()
 {
     m_timeSlice = {};
+    invalidateTiles();
     updateView();
 }
@@ -27,7 +27,10 @@
 
 #pragma once
 
+#include <QCache>
+#include <QImage>
 #include <QScopedPointer>
+#include <QSet>
 #include <QStyledItemDelegate>
 #include <QVector>
 
@@ -42,19 +45,22 @@ struct TimeLineData
 {
     TimeLineData();
 
-    TimeLineData(const Data::Events& events, quint64 maxCost, const Data::TimeRange& time,
+    TimeLineData(const Data::EventPyramid& pyramid, quint64 maxCost, const Data::TimeRange& time,
                  const Data::TimeRange& threadTime, QRect rect);
 
     int mapTimeToX(quint64 time) const;
 
     quint64 mapXToTime(int x) const;
 
+    // the time range that is painted into the pixel column @p x
+    Data::TimeRange mapXToTimeRange(int x) const;
+
     int mapCostToY(quint64 cost) const;
 
     void zoom(const Data::TimeRange &time);
 
     static const constexpr int padding = 2;
-    Data::Events events;
+    Data::EventPyramid pyramid;
     quint64 maxCost;
     Data::TimeRange time;
     Data::TimeRange threadTime;
@@ -83,11 +89,55 @@ protected:
     bool eventFilter(QObject* watched, QEvent* event) override;
 
 private:
+    // identifies the rendered image of a row, i.e. everything that influences how it looks
+    struct TileKey
+    {
+        qint32 processId = Data::INVALID_PID;
+        qint32 threadId = Data::INVALID_TID;
+        quint32 cpuId = Data::INVALID_CPU_ID;
+        Data::TimeRange time;
+        Data::TimeRange threadTime;
+        int eventType = 0;
+        QSize size;
+        qreal devicePixelRatio = 1;
+
+        bool operator==(const TileKey& rhs) const
+        {
+            return std::tie(processId, threadId, cpuId, time, threadTime, eventType, size, devicePixelRatio)
+                == std::tie(rhs.processId, rhs.threadId, rhs.cpuId, rhs.time, rhs.threadTime, rhs.eventType,
+                            rhs.size, rhs.devicePixelRatio);
+        }
+
+        friend uint qHash(const TileKey& key, uint seed = 0)
+        {
+            Util::HashCombine hash;
+            seed = hash(seed, key.processId);
+            seed = hash(seed, key.threadId);
+            seed = hash(seed, key.cpuId);
+            seed = hash(seed, key.time.start);
+            seed = hash(seed, key.time.end);
+            seed = hash(seed, key.eventType);
+            seed = hash(seed, key.size.width());
+            seed = hash(seed, key.size.height());
+            return seed;
+        }
+    };
+
     void updateView();
     void updateZoomState();
+    void invalidateTiles() const;
+    void requestTile(const TileKey& key, const TimeLineData& data, const QPalette& palette) const;
 
     FilterAndZoomStack* m_filterAndZoomStack = nullptr;
     QAbstractItemView* m_view = nullptr;
     Data::TimeRange m_timeSlice;
     int m_eventType = 0;
+
+    // the rows are rendered into images in the background, painting only blits them and the selection on top
+    // these are only accessed from the GUI thread, the render jobs report back via queued invocations
+    mutable QCache<TileKey, QImage> m_tiles;
+    mutable QSet<TileKey> m_pendingTiles;
+    mutable Data::Snapshot<Data::EventResults> m_tileResults;
+    // incremented whenever the tiles get invalidated, outdated render jobs are ignored
+    mutable uint m_tileGeneration = 0;
 };
@@ -58,7 +58,7 @@ QVariant BottomUpModel::headerColumnData(int column, int role) const
         case Binary:
             return tr("Binary");
         }
-        return tr("%1 (incl.)").arg(m_results.costs.typeName(column - NUM_BASE_COLUMNS));
+        return tr("%1 (incl.)").arg(m_results->costs.typeName(column - NUM_BASE_COLUMNS));
     } else if (role == Qt::ToolTipRole) {
         switch (column) {
         case Symbol:
@@ -70,7 +70,7 @@ QVariant BottomUpModel::headerColumnData(int column, int role) const
 
         return tr("The symbol's inclusive cost of type \"%1\", i.e. the aggregated sample costs attributed to this "
                   "symbol, both directly and indirectly.")
-            .arg(m_results.costs.typeName(column - NUM_BASE_COLUMNS));
+            .arg(m_results->costs.typeName(column - NUM_BASE_COLUMNS));
     } else {
         return {};
     }
@@ -86,14 +86,14 @@ QVariant BottomUpModel::rowData(const Data::BottomUp* row, int column, int role)
             return row->symbol.binary;
         }
         if (role == SortRole) {
-            return m_results.costs.cost(column - NUM_BASE_COLUMNS, row->id);
+            return m_results->costs.cost(column - NUM_BASE_COLUMNS, row->id);
         }
-        return Util::formatCostRelative(m_results.costs.cost(column - NUM_BASE_COLUMNS, row->id),
-                                        m_results.costs.totalCost(column - NUM_BASE_COLUMNS), true);
+        return Util::formatCostRelative(m_results->costs.cost(column - NUM_BASE_COLUMNS, row->id),
+                                        m_results->costs.totalCost(column - NUM_BASE_COLUMNS), true);
     } else if (role == TotalCostRole && column >= NUM_BASE_COLUMNS) {
-        return m_results.costs.totalCost(column - NUM_BASE_COLUMNS);
+        return m_results->costs.totalCost(column - NUM_BASE_COLUMNS);
     } else if (role == Qt::ToolTipRole) {
-        return Util::formatTooltip(row->id, row->symbol, m_results.costs);
+        return Util::formatTooltip(row->id, row->symbol, m_results->costs);
     } else {
         return {};
     }
@@ -101,7 +101,7 @@ QVariant BottomUpModel::rowData(const Data::BottomUp* row, int column, int role)
 
 int BottomUpModel::numColumns() const
 {
-    return NUM_BASE_COLUMNS + m_results.costs.numTypes();
+    return NUM_BASE_COLUMNS + m_results->costs.numTypes();
 }
 
 TopDownModel::TopDownModel(QObject* parent)
@@ -127,12 +127,12 @@ QVariant TopDownModel::headerColumnData(int column, int role) const
             return tr("Binary");
         }
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.inclusiveCosts.numTypes()) {
-            return tr("%1 (incl.)").arg(m_results.inclusiveCosts.typeName(column));
+        if (column < m_results->inclusiveCosts.numTypes()) {
+            return tr("%1 (incl.)").arg(m_results->inclusiveCosts.typeName(column));
         }
 
-        column -= m_results.inclusiveCosts.numTypes();
-        return tr("%1 (self)").arg(m_results.selfCosts.typeName(column));
+        column -= m_results->inclusiveCosts.numTypes();
+        return tr("%1 (self)").arg(m_results->selfCosts.typeName(column));
     } else if (role == Qt::ToolTipRole) {
         switch (column) {
         case Symbol:
@@ -142,20 +142,20 @@ QVariant TopDownModel::headerColumnData(int column, int role) const
                 "The name of the executable the symbol resides in. May be empty when debug information is missing.");
         }
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.inclusiveCosts.numTypes()) {
+        if (column < m_results->inclusiveCosts.numTypes()) {
             return tr("The symbol's inclusive cost of type \"%1\", i.e. the aggregated sample costs attributed to this "
                       "symbol, "
                       "both directly and indirectly. This includes the costs of all functions called by this symbol "
                       "plus "
                       "its self cost.")
-                .arg(m_results.inclusiveCosts.typeName(column));
+                .arg(m_results->inclusiveCosts.typeName(column));
         }
 
-        column -= m_results.inclusiveCosts.numTypes();
+        column -= m_results->inclusiveCosts.numTypes();
         return tr("The symbol's self cost of type \"%1\", i.e. the aggregated sample costs directly attributed to this "
                   "symbol. "
                   "This excludes the costs of all functions called by this symbol.")
-            .arg(m_results.selfCosts.typeName(column));
+            .arg(m_results->selfCosts.typeName(column));
     } else {
         return {};
     }
@@ -172,30 +172,30 @@ QVariant TopDownModel::rowData(const Data::TopDown* row, int column, int role) c
         }
 
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.inclusiveCosts.numTypes()) {
+        if (column < m_results->inclusiveCosts.numTypes()) {
             if (role == SortRole) {
-                return m_results.inclusiveCosts.cost(column, row->id);
+                return m_results->inclusiveCosts.cost(column, row->id);
             }
-            return Util::formatCostRelative(m_results.inclusiveCosts.cost(column, row->id),
-                                            m_results.inclusiveCosts.totalCost(column), true);
+            return Util::formatCostRelative(m_results->inclusiveCosts.cost(column, row->id),
+                                            m_results->inclusiveCosts.totalCost(column), true);
         }
 
-        column -= m_results.inclusiveCosts.numTypes();
+        column -= m_results->inclusiveCosts.numTypes();
         if (role == SortRole) {
-            return m_results.selfCosts.cost(column, row->id);
+            return m_results->selfCosts.cost(column, row->id);
         }
-        return Util::formatCostRelative(m_results.selfCosts.cost(column, row->id),
-                                        m_results.selfCosts.totalCost(column), true);
+        return Util::formatCostRelative(m_results->selfCosts.cost(column, row->id),
+                                        m_results->selfCosts.totalCost(column), true);
     } else if (role == TotalCostRole && column >= NUM_BASE_COLUMNS) {
         column -= NUM_BASE_COLUMNS;
-        if (column < m_results.inclusiveCosts.numTypes()) {
-            return m_results.inclusiveCosts.totalCost(column);
+        if (column < m_results->inclusiveCosts.numTypes()) {
+            return m_results->inclusiveCosts.totalCost(column);
         }
 
-        column -= m_results.inclusiveCosts.numTypes();
-        return m_results.selfCosts.totalCost(column);
+        column -= m_results->inclusiveCosts.numTypes();
+        return m_results->selfCosts.totalCost(column);
     } else if (role == Qt::ToolTipRole) {
-        return Util::formatTooltip(row->id, row->symbol, m_results.selfCosts, m_results.inclusiveCosts);
+        return Util::formatTooltip(row->id, row->symbol, m_results->selfCosts, m_results->inclusiveCosts);
     } else {
         return {};
     }
@@ -203,5 +203,5 @@ QVariant TopDownModel::rowData(const Data::TopDown* row, int column, int role) c
 
 int TopDownModel::numColumns() const
 {
-    return NUM_BASE_COLUMNS + m_results.selfCosts.numTypes() + m_results.inclusiveCosts.numTypes();
+    return NUM_BASE_COLUMNS + m_results->selfCosts.numTypes() + m_results->inclusiveCosts.numTypes();
 }
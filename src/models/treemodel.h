@@ -253,30 +253,36 @@ public:
     using Base = TreeModel<decltype(Results::root), ModelImpl>;
     CostTreeModel(QObject* parent = nullptr)
         : Base(parent)
+        , m_results(Data::makeSnapshot(Results()))
     {
     }
     ~CostTreeModel() = default;
 
     using Base::setData;
-    void setData(const Results& data)
+    void setData(const Data::Snapshot<Results>& data)
     {
         QAbstractItemModel::beginResetModel();
         m_results = data;
         QAbstractItemModel::endResetModel();
     }
 
-    Results results() const
+    void setData(const Results& data)
+    {
+        setData(Data::makeSnapshot(data));
+    }
+
+    const Results& results() const
     {
-        return m_results;
+        return *m_results;
     }
 
 protected:
     const typename Base::TreeNode* rootItem() const final override
     {
-        return &m_results.root;
+        return &m_results->root;
     }
 
-    Results m_results;
+    Data::Snapshot<Results> m_results;
 };
 
 class BottomUpModel : public CostTreeModel<Data::BottomUpResults, BottomUpModel>
@@ -27,20 +27,25 @@
 
 #include "perfparser.h"
 
-#include <QBuffer>
 #include <QDataStream>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QEventLoop>
 #include <QFileInfo>
 #include <QLoggingCategory>
+#include <QMutex>
 #include <QProcess>
+#include <QSemaphore>
 #include <QtEndian>
 
 #include <ThreadWeaver/ThreadWeaver>
 
 #include <util.h>
 
+#include <atomic>
+#include <cstring>
 #include <functional>
+#include <iterator>
 
 Q_LOGGING_CATEGORY(LOG_PERFPARSER, "hotspot.perfparser", QtWarningMsg)
 
@@ -311,6 +316,106 @@ QDebug operator<<(QDebug stream, const ContextSwitchDefinition& contextSwitch)
     return stream.space();
 }
 
+/**
+ * Decodes the fixed-layout fields of the hot events directly from memory.
+ *
+ * This follows the QDataStream encoding used by perfparser, i.e. big endian
+ * fixed-size integers and a quint32 element count in front of vectors, but
+ * does not need to go through the QIODevice/QDataStream indirections.
+ */
+class EventReader
+{
+public:
+    EventReader(const char* data, quint32 size)
+        : m_data(data)
+        , m_end(data + size)
+    {
+    }
+
+    template<typename T>
+    bool read(T* value)
+    {
+        if (!canRead(sizeof(T))) {
+            return false;
+        }
+        *value = qFromBigEndian<T>(m_data);
+        m_data += sizeof(T);
+        return true;
+    }
+
+    bool read(bool* value)
+    {
+        qint8 byte = 0;
+        if (!read(&byte)) {
+            return false;
+        }
+        *value = byte != 0;
+        return true;
+    }
+
+    bool canRead(quint64 size) const
+    {
+        return static_cast<quint64>(m_end - m_data) >= size;
+    }
+
+    bool atEnd() const
+    {
+        return m_data == m_end;
+    }
+
+    const char* data() const
+    {
+        return m_data;
+    }
+
+    quint32 size() const
+    {
+        return static_cast<quint32>(m_end - m_data);
+    }
+
+private:
+    const char* m_data;
+    const char* m_end;
+};
+
+bool readRecord(EventReader* reader, Record* record)
+{
+    return reader->read(&record->pid) && reader->read(&record->tid) && reader->read(&record->time)
+        && reader->read(&record->cpu);
+}
+
+// reuses the storage of @p sample, such that decoding does not allocate once the
+// vectors have grown to the size required by the deepest stack
+bool readSample(EventReader* reader, Sample* sample)
+{
+    quint32 numFrames = 0;
+    if (!readRecord(reader, sample) || !reader->read(&numFrames)
+        || !reader->canRead(static_cast<quint64>(numFrames) * sizeof(qint32))) {
+        return false;
+    }
+    sample->frames.resize(numFrames);
+    for (auto& frame : sample->frames) {
+        reader->read(&frame);
+    }
+
+    quint32 numCosts = 0;
+    if (!reader->read(&sample->guessedFrames) || !reader->read(&numCosts)
+        || !reader->canRead(static_cast<quint64>(numCosts) * (sizeof(qint32) + sizeof(quint64)))) {
+        return false;
+    }
+    sample->costs.resize(numCosts);
+    for (auto& sampleCost : sample->costs) {
+        reader->read(&sampleCost.attributeId);
+        reader->read(&sampleCost.cost);
+    }
+    return true;
+}
+
+bool readContextSwitch(EventReader* reader, ContextSwitchDefinition* contextSwitch)
+{
+    return readRecord(reader, contextSwitch) && reader->read(&contextSwitch->switchOut);
+}
+
 struct StringDefinition
 {
     qint32 id = 0;
@@ -516,13 +621,15 @@ QDebug operator<<(QDebug stream, const Error& error)
     return stream;
 }
 
-void addCallerCalleeEvent(const Data::Symbol& symbol, const Data::Location& location, int type, quint64 cost,
-                          QSet<Data::Symbol>* recursionGuard, Data::CallerCalleeResults* callerCalleeResult,
-                          int numCosts)
+// caller/callee entries keyed by the interned symbol ids, to keep string hashing off the hot path
+using SymbolIdCallerCalleeEntries = QHash<Data::SymbolId, Data::CallerCalleeEntry>;
+
+void addCallerCalleeEvent(Data::SymbolId symbolId, const Data::Location& location, int type, quint64 cost,
+                          QSet<Data::SymbolId>* recursionGuard, SymbolIdCallerCalleeEntries* entries, int numCosts)
 {
-    auto recursionIt = recursionGuard->find(symbol);
+    auto recursionIt = recursionGuard->find(symbolId);
     if (recursionIt == recursionGuard->end()) {
-        auto& entry = callerCalleeResult->entry(symbol);
+        auto& entry = (*entries)[symbolId];
         auto& locationCost = entry.source(location.location, numCosts);
 
         locationCost.inclusiveCost[type] += cost;
@@ -530,7 +637,7 @@ void addCallerCalleeEvent(const Data::Symbol& symbol, const Data::Location& loca
             // increment self cost for leaf
             locationCost.selfCost[type] += cost;
         }
-        recursionGuard->insert(symbol);
+        recursionGuard->insert(symbolId);
     }
 }
 
@@ -538,6 +645,279 @@ struct SymbolCount {
     qint32 total = 0;
     qint32 missing = 0;
 };
+
+// resolves the symbol ids of @p partial via @p tables and adds their source costs to @p results
+void mergeCallerCalleeSources(const SymbolIdCallerCalleeEntries& partial, const Data::BottomUpResults& tables,
+                              Data::CallerCalleeResults* results, int numCosts)
+{
+    // merge in a deterministic order, this defines the ids of new entries
+    auto symbolIds = partial.keys();
+    std::sort(symbolIds.begin(), symbolIds.end());
+
+    for (auto symbolId : symbolIds) {
+        auto& entry = results->entry(tables.symbolTable.value(symbolId));
+        const auto& sourceMap = partial.constFind(symbolId)->sourceMap;
+        for (auto sourceIt = sourceMap.begin(), sourceEnd = sourceMap.end(); sourceIt != sourceEnd; ++sourceIt) {
+            auto& locationCost = entry.source(sourceIt.key(), numCosts);
+            for (size_t i = 0, c = std::min(locationCost.selfCost.size(), sourceIt->selfCost.size()); i < c; ++i) {
+                locationCost.selfCost[i] += sourceIt->selfCost[i];
+                locationCost.inclusiveCost[i] += sourceIt->inclusiveCost[i];
+            }
+        }
+    }
+}
+
+template<typename Tree>
+qint64 numTreeNodes(const Tree& tree)
+{
+    qint64 numNodes = tree.children.size();
+    for (const auto& child : tree.children) {
+        numNodes += numTreeNodes(child);
+    }
+    return numNodes;
+}
+
+// this only needs to be roughly right, it is used to bound the size of the filter cache
+template<typename FilterResults>
+qint64 estimateMemoryUsage(const FilterResults& results)
+{
+    qint64 eventsSize = 0;
+    for (const auto& thread : results.events->threads) {
+        eventsSize += thread.events.memoryUsage();
+    }
+    for (const auto& cpu : results.events->cpus) {
+        eventsSize += cpu.events.size() * sizeof(Data::EventIndex);
+    }
+
+    const qint64 costSize = sizeof(qint64) * results.bottomUp->costs.numTypes();
+    return eventsSize
+        + numTreeNodes(results.bottomUp->root) * (sizeof(Data::BottomUp) + costSize)
+        + numTreeNodes(results.topDown->root) * (sizeof(Data::TopDown) + 2 * costSize)
+        + results.callerCallee->entries.size() * (sizeof(Data::CallerCalleeEntry) + 2 * costSize);
+}
+
+/**
+ * Calls @p callback(begin, end) for consecutive chunks of [0, size) in parallel on the ThreadWeaver queue.
+ *
+ * The calling thread takes part in the work. Helper jobs which did not get started until all chunks
+ * have been handed out are dequeued again, such that this never blocks when called from within a job
+ * while the queue is busy.
+ */
+template<typename Callback>
+void parallelForChunks(int size, int chunkSize, Callback callback)
+{
+    if (size <= 0) {
+        return;
+    }
+
+    const int numChunks = (size + chunkSize - 1) / chunkSize;
+    std::atomic<int> nextChunk(0);
+    auto work = [&nextChunk, &callback, numChunks, chunkSize, size]() {
+        for (int chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++) {
+            const int begin = chunk * chunkSize;
+            callback(begin, std::min(begin + chunkSize, size));
+        }
+    };
+
+    auto* queue = ThreadWeaver::Queue::instance();
+    const int numHelpers = std::min(numChunks, queue->maximumNumberOfThreads()) - 1;
+    QSemaphore finishedHelpers;
+    QVector<ThreadWeaver::JobPointer> helpers;
+    helpers.reserve(numHelpers);
+    for (int i = 0; i < numHelpers; ++i) {
+        helpers.append(ThreadWeaver::make_job([&work, &finishedHelpers]() {
+            work();
+            finishedHelpers.release();
+        }));
+        queue->enqueue(helpers.last());
+    }
+
+    work();
+
+    int numStartedHelpers = 0;
+    for (const auto& helper : helpers) {
+        if (!queue->dequeue(helper)) {
+            ++numStartedHelpers;
+        }
+    }
+    finishedHelpers.acquire(numStartedHelpers);
+}
+
+/**
+ * Derives the top-down and caller/callee data from @p bottomUp.
+ *
+ * Both are independent of each other, so they get built concurrently. Additionally, each one is split
+ * over chunks of the children of the bottom up root, i.e. over separate subtrees. The partial results
+ * are merged in chunk order afterwards, which keeps the ids and row order deterministic.
+ *
+ * @p callerCallee may already contain entries, e.g. the source maps from the aggregation.
+ */
+void deriveTopDownAndCallerCallee(const Data::BottomUpResults& bottomUp, Data::TopDownResults* topDown,
+                                  Data::CallerCalleeResults* callerCallee)
+{
+    const int numRows = bottomUp.root.children.size();
+    // some more chunks than threads, to balance differently sized subtrees
+    const int numChunksPerThread = 4;
+    const int chunkSize =
+        std::max(1, numRows / (numChunksPerThread * ThreadWeaver::Queue::instance()->maximumNumberOfThreads()));
+    const int numChunks = (numRows + chunkSize - 1) / chunkSize;
+
+    QVector<Data::TopDownResults> topDownPartials(numChunks);
+    QVector<Data::CallerCalleeResults> callerCalleePartials(numChunks);
+    // the first half of the tasks builds the top-down chunks, the second half the caller/callee ones
+    parallelForChunks(2 * numChunks, 1, [&](int begin, int end) {
+        for (int task = begin; task < end; ++task) {
+            const int chunk = task % numChunks;
+            const int first = chunk * chunkSize;
+            const int last = std::min(first + chunkSize, numRows);
+            if (task < numChunks) {
+                topDownPartials[chunk] = Data::TopDownResults::fromBottomUp(bottomUp, first, last);
+            } else {
+                Data::callerCalleesFromBottomUpData(bottomUp, &callerCalleePartials[chunk], first, last);
+            }
+        }
+    });
+
+    *topDown = Data::TopDownResults();
+    topDown->selfCosts.initializeCostsFrom(bottomUp.costs);
+    topDown->inclusiveCosts.initializeCostsFrom(bottomUp.costs);
+    callerCallee->selfCosts.initializeCostsFrom(bottomUp.costs);
+    callerCallee->inclusiveCosts.initializeCostsFrom(bottomUp.costs);
+
+    // the merges are sequential by nature, but again independent of each other
+    parallelForChunks(2, 1, [&](int begin, int end) {
+        for (int task = begin; task < end; ++task) {
+            if (task == 0) {
+                for (const auto& partial : topDownPartials) {
+                    topDown->merge(partial);
+                }
+                Data::TopDown::initializeParents(&topDown->root);
+            } else {
+                for (const auto& partial : callerCalleePartials) {
+                    callerCallee->merge(partial);
+                }
+            }
+        }
+    });
+}
+
+/**
+ * Sums up the costs of all events per stack and cost type.
+ *
+ * Most events share a comparatively small number of unique stacks. Aggregating the
+ * histogram means every unique stack only needs to be walked once, with its summed cost.
+ */
+class StackHistogram
+{
+public:
+    void add(qint32 stackId, qint32 type, quint64 cost)
+    {
+        if (m_costs.size() <= type) {
+            m_costs.resize(type + 1);
+        }
+        auto& costs = m_costs[type];
+        if (costs.size() <= stackId) {
+            costs.resize(stackId + 1);
+        }
+        costs[stackId] += cost;
+    }
+
+    // one past the largest stack id with a cost
+    qint32 numStacks() const
+    {
+        int numStacks = 0;
+        for (const auto& costs : m_costs) {
+            numStacks = std::max(numStacks, costs.size());
+        }
+        return numStacks;
+    }
+
+    // callback gets the stack id, cost type and summed cost of every stack with a non-zero cost
+    template<typename Callback>
+    void forEach(Callback callback) const
+    {
+        forEach(0, numStacks(), callback);
+    }
+
+    // like the above, but only for the stacks with an id in [begin, end)
+    template<typename Callback>
+    void forEach(qint32 begin, qint32 end, Callback callback) const
+    {
+        // iterate per stack, to walk it only once for all of its costs
+        for (qint32 stackId = begin; stackId < end; ++stackId) {
+            for (qint32 type = 0, c = m_costs.size(); type < c; ++type) {
+                const auto& costs = m_costs[type];
+                if (stackId < costs.size() && costs[stackId]) {
+                    callback(stackId, type, costs[stackId]);
+                }
+            }
+        }
+    }
+
+private:
+    // indexed by cost type, then stack id
+    QVector<QVector<quint64>> m_costs;
+};
+
+/**
+ * Aggregates the bottom-up and caller/callee data of the stacks in @p stackCosts.
+ *
+ * The stacks get split into chunks of consecutive ids, which are aggregated into partial trees in parallel
+ * on the ThreadWeaver queue. The chunks only depend on the number of stacks and the partial results get
+ * merged in chunk order, such that the ids and row order are the same regardless of the number of threads.
+ *
+ * The frames of the stacks are taken from @p events and resolved via the symbol and location tables
+ * of @p bottomUp. Chunks are skipped once @p isCancelled returns true, the results are incomplete then.
+ */
+template<typename IsCancelled>
+void aggregateStacks(const StackHistogram& stackCosts, const Data::EventResults& events,
+                     Data::BottomUpResults* bottomUp, Data::CallerCalleeResults* callerCallee, IsCancelled isCancelled)
+{
+    struct Partial
+    {
+        Data::FlatBottomUp bottomUp;
+        SymbolIdCallerCalleeEntries callerCallee;
+    };
+
+    const int minChunkSize = 1024;
+    const int maxNumChunks = 64;
+    const int numStacks = stackCosts.numStacks();
+    const int chunkSize = std::max(minChunkSize, (numStacks + maxNumChunks - 1) / maxNumChunks);
+    const int numChunks = (numStacks + chunkSize - 1) / chunkSize;
+
+    const Data::BottomUpResults& tables = *bottomUp;
+    const auto numCosts = tables.costs.numTypes();
+    QVector<Partial> partials(numChunks);
+    parallelForChunks(numChunks, 1, [&](int begin, int end) {
+        for (int chunk = begin; chunk < end && !isCancelled(); ++chunk) {
+            auto& partial = partials[chunk];
+            for (int type = 0; type < numCosts; ++type) {
+                partial.bottomUp.costs.addType(type, tables.costs.typeName(type), tables.costs.unit(type));
+            }
+
+            QSet<Data::SymbolId> recursionGuard;
+            auto addStack = [&](qint32 stackId, qint32 type, quint64 cost) {
+                recursionGuard.clear();
+                auto frameCallback = [&](Data::SymbolId symbolId, const Data::Location& location) {
+                    addCallerCalleeEvent(symbolId, location, type, cost, &recursionGuard, &partial.callerCallee,
+                                         numCosts);
+                };
+                tables.addEvent(&partial.bottomUp, type, cost, events.stackFrames(stackId), frameCallback);
+            };
+            const int first = chunk * chunkSize;
+            stackCosts.forEach(first, std::min(first + chunkSize, numStacks), addStack);
+        }
+    });
+
+    if (isCancelled()) {
+        return;
+    }
+
+    for (const auto& partial : partials) {
+        bottomUp->merge(partial.bottomUp);
+        mergeCallerCalleeSources(partial.callerCallee, tables, callerCallee, numCosts);
+    }
+}
 }
 
 Q_DECLARE_TYPEINFO(AttributesDefinition, Q_MOVABLE_TYPE);
@@ -547,13 +927,39 @@ class PerfParserPrivate : public QObject
 {
     Q_OBJECT
 public:
+    enum State
+    {
+        HEADER,
+        DATA_STREAM_VERSION,
+        EVENT_HEADER,
+        EVENT,
+        PARSE_ERROR
+    };
+
+    enum class EventType {
+        ThreadStart,
+        ThreadEnd,
+        Command,
+        LocationDefinition,
+        SymbolDefinition,
+        StringDefinition,
+        LostDefinition,
+        FeaturesDefinition,
+        Error,
+        Progress,
+        TracePointFormat,
+        AttributesDefinition,
+        ContextSwitchDefinition,
+        Sample,
+        TracePointSample,
+        InvalidType
+    };
+
     explicit PerfParserPrivate(QObject* parent = nullptr)
         : QObject(parent)
         , stopRequested(false)
     {
-        buffer.buffer().reserve(1024);
-        buffer.open(QIODevice::ReadOnly);
-        stream.setDevice(&buffer);
+        buffer.reserve(BUFFER_SIZE);
         process.setProcessEnvironment(Util::appImageEnvironment());
         process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
 
@@ -567,14 +973,13 @@ public:
         if (stopRequested) {
             return false;
         }
-        const auto bytesAvailable = process.bytesAvailable();
         switch (state) {
         case HEADER: {
             const auto magic = QByteArrayLiteral("QPERFSTREAM");
             // + 1 to include the trailing \0
-            if (bytesAvailable >= magic.size() + 1) {
-                process.read(buffer.buffer().data(), magic.size() + 1);
-                if (buffer.buffer().data() != magic) {
+            if (fillBuffer(magic.size() + 1)) {
+                const auto* data = consume(magic.size() + 1);
+                if (memcmp(data, magic.constData(), magic.size() + 1) != 0) {
                     state = PARSE_ERROR;
                     qCWarning(LOG_PERFPARSER) << "Failed to read header magic";
                     return false;
@@ -586,11 +991,8 @@ public:
             break;
         }
         case DATA_STREAM_VERSION: {
-            qint32 dataStreamVersion = 0;
-            if (bytesAvailable >= static_cast<qint64>(sizeof(dataStreamVersion))) {
-                process.read(buffer.buffer().data(), sizeof(dataStreamVersion));
-                dataStreamVersion = qFromLittleEndian(*reinterpret_cast<qint32*>(buffer.buffer().data()));
-                stream.setVersion(dataStreamVersion);
+            if (fillBuffer(sizeof(dataStreamVersion))) {
+                dataStreamVersion = qFromLittleEndian<qint32>(consume(sizeof(dataStreamVersion)));
                 qCDebug(LOG_PERFPARSER) << "data stream version is:" << dataStreamVersion;
                 state = EVENT_HEADER;
                 return true;
@@ -598,19 +1000,16 @@ public:
             break;
         }
         case EVENT_HEADER:
-            if (bytesAvailable >= static_cast<qint64>(sizeof(eventSize))) {
-                process.read(buffer.buffer().data(), sizeof(eventSize));
-                eventSize = qFromLittleEndian(*reinterpret_cast<quint32*>(buffer.buffer().data()));
+            if (fillBuffer(sizeof(eventSize))) {
+                eventSize = qFromLittleEndian<quint32>(consume(sizeof(eventSize)));
                 qCDebug(LOG_PERFPARSER) << "next event size is:" << eventSize;
                 state = EVENT;
                 return true;
             }
             break;
         case EVENT:
-            if (bytesAvailable >= static_cast<qint64>(eventSize)) {
-                buffer.buffer().resize(eventSize);
-                process.read(buffer.buffer().data(), eventSize);
-                if (!parseEvent()) {
+            if (fillBuffer(eventSize)) {
+                if (!parseEvent(consume(eventSize), eventSize)) {
                     state = PARSE_ERROR;
                     return false;
                 }
@@ -627,18 +1026,45 @@ public:
         return false;
     }
 
-    bool parseEvent()
+    // ensure at least @p size bytes are buffered, reading everything the process has
+    // available in one go, such that we don't need to read once per event
+    bool fillBuffer(qint64 size)
     {
-        Q_ASSERT(buffer.isOpen());
-        Q_ASSERT(buffer.isReadable());
+        const qint64 buffered = buffer.size() - bufferPos;
+        if (buffered >= size) {
+            return true;
+        }
 
-        buffer.seek(0);
-        Q_ASSERT(buffer.pos() == 0);
+        const auto bytesAvailable = process.bytesAvailable();
+        if (buffered + bytesAvailable < size) {
+            return false;
+        }
+
+        // move the remaining bytes to the front, then append the new data
+        buffer.remove(0, bufferPos);
+        bufferPos = 0;
+        const auto oldSize = buffer.size();
+        buffer.resize(oldSize + bytesAvailable);
+        const auto bytesRead = process.read(buffer.data() + oldSize, bytesAvailable);
+        buffer.resize(oldSize + std::max(bytesRead, qint64(0)));
+        return buffer.size() - bufferPos >= size;
+    }
 
-        stream.resetStatus();
+    // the returned data stays valid until the next call to fillBuffer
+    const char* consume(qint64 size)
+    {
+        Q_ASSERT(buffer.size() - bufferPos >= size);
+        const auto* data = buffer.constData() + bufferPos;
+        bufferPos += size;
+        return data;
+    }
+
+    bool parseEvent(const char* data, quint32 size)
+    {
+        EventReader reader(data, size);
 
         qint8 eventType = 0;
-        stream >> eventType;
+        reader.read(&eventType);
         qCDebug(LOG_PERFPARSER) << "next event is:" << eventType;
 
         if (eventType < 0 || eventType >= static_cast<qint8>(EventType::InvalidType)) {
@@ -647,13 +1073,17 @@ public:
             return false;
         }
 
+        // the hot events get decoded directly from the buffer, everything else is rare
+        // enough to go through QDataStream
         switch (static_cast<EventType>(eventType)) {
         case EventType::TracePointSample:
         case EventType::Sample: {
-            Sample sample;
-            stream >> sample;
-            qCDebug(LOG_PERFPARSER) << "parsed:" << sample;
-            for (auto& sampleCost : sample.costs) {
+            if (!readSample(&reader, &currentSample)) {
+                qCWarning(LOG_PERFPARSER) << "failed to read sample event";
+                return false;
+            }
+            qCDebug(LOG_PERFPARSER) << "parsed:" << currentSample;
+            for (auto& sampleCost : currentSample.costs) {
                 if (!sampleCost.cost) {
                     const auto& attribute = attributes.value(sampleCost.attributeId);
                     if (!attribute.usesFrequency) {
@@ -662,21 +1092,49 @@ public:
                 }
             }
 
-            addRecord(sample);
-            addSample(sample);
+            addRecord(currentSample);
+            addSample(currentSample);
 
             if (static_cast<EventType>(eventType) == EventType::TracePointSample)
                 return true; // TODO: read full data
             break;
         }
+        case EventType::ContextSwitchDefinition: {
+            ContextSwitchDefinition contextSwitch;
+            if (!readContextSwitch(&reader, &contextSwitch)) {
+                qCWarning(LOG_PERFPARSER) << "failed to read context switch event";
+                return false;
+            }
+            qCDebug(LOG_PERFPARSER) << "parsed:" << contextSwitch;
+            addRecord(contextSwitch);
+            addContextSwitch(contextSwitch);
+            break;
+        }
+        default:
+            return parseStreamEvent(static_cast<EventType>(eventType), reader.data(), reader.size());
+        }
+
+        if (!reader.atEnd()) {
+            qCWarning(LOG_PERFPARSER) << "did not consume all bytes for event of type" << eventType << reader.size();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool parseStreamEvent(EventType eventType, const char* data, quint32 size)
+    {
+        const auto payload = QByteArray::fromRawData(data, size);
+        QDataStream stream(payload);
+        stream.setVersion(dataStreamVersion);
+
+        switch (eventType) {
         case EventType::ThreadStart: {
             ThreadStart threadStart;
             stream >> threadStart;
             qCDebug(LOG_PERFPARSER) << "parsed:" << threadStart;
             addRecord(threadStart);
-            // override start time explicitly
-            auto thread = addThread(threadStart);
-            thread->time.start = threadStart.time;
+            auto thread = addThread(threadStart, threadStart.time);
             if (threadStart.ppid != threadStart.pid) {
                 const auto parentComm = commands.value(threadStart.ppid).value(threadStart.ppid);
                 commands[threadStart.pid][threadStart.pid] = parentComm;
@@ -750,14 +1208,6 @@ public:
             addError(error);
             break;
         }
-        case EventType::ContextSwitchDefinition: {
-            ContextSwitchDefinition contextSwitch;
-            stream >> contextSwitch;
-            qCDebug(LOG_PERFPARSER) << "parsed:" << contextSwitch;
-            addRecord(contextSwitch);
-            addContextSwitch(contextSwitch);
-            break;
-        }
         case EventType::Progress: {
             float percent = 0;
             stream >> percent;
@@ -768,13 +1218,17 @@ public:
         case EventType::TracePointFormat:
             // TODO: implement me
             return true;
+        case EventType::Sample:
+        case EventType::TracePointSample:
+        case EventType::ContextSwitchDefinition:
+            // decoded in parseEvent already
         case EventType::InvalidType:
             break;
         }
 
         if (!stream.atEnd()) {
-            qCWarning(LOG_PERFPARSER) << "did not consume all bytes for event of type" << eventType << buffer.pos()
-                                      << buffer.size();
+            qCWarning(LOG_PERFPARSER) << "did not consume all bytes for event of type" << static_cast<int>(eventType)
+                                      << size;
             return false;
         }
 
@@ -783,14 +1237,14 @@ public:
 
     void finalize()
     {
+        aggregateStacks(stackCosts, eventResult, &bottomUpResult, &callerCalleeResult, []() { return false; });
         Data::BottomUp::initializeParents(&bottomUpResult.root);
 
         summaryResult.applicationRunningTime = applicationTime.delta();
         summaryResult.threadCount = uniqueThreads.size();
         summaryResult.processCount = uniqueProcess.size();
 
-        buildTopDownResult();
-        buildCallerCalleeResult();
+        deriveTopDownAndCallerCallee(bottomUpResult, &topDownResult, &callerCalleeResult);
 
         for (auto& thread : eventResult.threads) {
             thread.time.start = std::max(thread.time.start, applicationTime.start);
@@ -811,6 +1265,16 @@ public:
             }
         }
 
+        // when profiling live, the aggregated data covers the whole recording but the timeline only the last window
+        if (liveWindow) {
+            trimLiveEvents(true);
+            const auto windowStart = liveWindowStart();
+            for (auto& thread : eventResult.threads) {
+                // threads that ended before the window collapse to their end
+                thread.time.start = std::min(std::max(thread.time.start, windowStart), thread.time.end);
+            }
+        }
+
         {
             uint cpuId = 0;
             for (auto& cpu : eventResult.cpus) {
@@ -831,6 +1295,134 @@ public:
         }
     }
 
+    // true when the next partial results should be built, see buildPartialResults
+    bool partialResultsDue() const
+    {
+        return partialResultsInterval > 0 && summaryResult.sampleCount > 0
+            && partialResultsTimer.hasExpired(nextPartialResults);
+    }
+
+    /**
+     * Aggregates the samples parsed so far into separate results, the parse state itself stays untouched.
+     *
+     * When profiling live, the results only cover the events within the live window. Only then @p events
+     * may be given, to get a copy of these. The copy may still contain some events from before the window
+     * start, see trimLiveEvents, the thread times mark the window.
+     */
+    void buildPartialResults(Data::BottomUpResults* bottomUp, Data::TopDownResults* topDown, Data::Summary* summary,
+                             Data::EventResults* events = nullptr)
+    {
+        QElapsedTimer buildTimer;
+        buildTimer.start();
+
+        StackHistogram windowCosts;
+        if (liveWindow) {
+            trimLiveEvents(false);
+            const auto windowStart = liveWindowStart();
+            for (const auto& thread : eventResult.threads) {
+                const auto windowBegin =
+                    Data::findEventsInTimeRange(thread.events, {windowStart, Data::MAX_TIME}).first.index();
+                for (int i = windowBegin, c = thread.events.size(); i < c; ++i) {
+                    // off-CPU events may lack a stack, these are not part of the bottom up data
+                    const auto stackId = thread.events.stackId(i);
+                    const auto type = thread.events.type(i);
+                    if (stackId >= 0 && type >= 0) {
+                        windowCosts.add(stackId, type, thread.events.cost(i));
+                    }
+                }
+            }
+        }
+
+        bottomUp->symbols = bottomUpResult.symbols;
+        bottomUp->symbolIds = bottomUpResult.symbolIds;
+        bottomUp->symbolTable = bottomUpResult.symbolTable;
+        bottomUp->locations = bottomUpResult.locations;
+        bottomUp->costs.initializeCostsFrom(bottomUpResult.costs);
+        {
+            // the caller/callee data is only built once parsing finished, drop the source maps
+            Data::CallerCalleeResults callerCallee;
+            aggregateStacks(liveWindow ? windowCosts : stackCosts, eventResult, bottomUp, &callerCallee,
+                            []() { return false; });
+        }
+        Data::BottomUp::initializeParents(&bottomUp->root);
+        *topDown = Data::TopDownResults::fromBottomUp(*bottomUp);
+
+        *summary = summaryResult;
+        summary->applicationRunningTime = applicationTime.delta();
+        summary->threadCount = uniqueThreads.size();
+        summary->processCount = uniqueProcess.size();
+
+        if (events) {
+            Q_ASSERT(liveWindow);
+            *events = eventResult;
+            const auto windowStart = liveWindowStart();
+            for (auto& thread : events->threads) {
+                thread.time.end = std::min(thread.time.end, applicationTime.end);
+                thread.time.start = std::min(std::max(thread.time.start, windowStart), thread.time.end);
+                if (thread.name.isEmpty()) {
+                    thread.name = PerfParser::tr("#%1").arg(thread.tid);
+                }
+            }
+            uint cpuId = 0;
+            for (auto& cpu : events->cpus) {
+                cpu.cpuId = cpuId++;
+            }
+            events->totalCosts = summaryResult.costs;
+        }
+
+        // the aggregation gets more expensive the more unique stacks we have seen, for huge files
+        // we rather publish less often than spend most of the time on intermediate results
+        nextPartialResults =
+            partialResultsTimer.elapsed() + std::max<qint64>(partialResultsInterval, 4 * buildTimer.elapsed());
+    }
+
+    // the oldest time that is still within the live window
+    quint64 liveWindowStart() const
+    {
+        return applicationTime.end > applicationTime.start + liveWindow ? applicationTime.end - liveWindow
+                                                                        : applicationTime.start;
+    }
+
+    // drops the events that are older than the live window, which bounds their memory usage while profiling live
+    // the aggregated data covers the whole recording, see startParseLive, it's not affected by this
+    // unless @p exact is set, only whole blocks of events get dropped and only once they make up half of the
+    // thread's events, which keeps the cost amortized at the expense of keeping up to twice the window around
+    void trimLiveEvents(bool exact)
+    {
+        const auto windowStart = liveWindowStart();
+        QVector<int> numDropped(eventResult.threads.size());
+        bool anyDropped = false;
+        for (int i = 0, c = eventResult.threads.size(); i < c; ++i) {
+            auto& events = eventResult.threads[i].events;
+            const auto windowBegin = Data::findEventsInTimeRange(events, {windowStart, Data::MAX_TIME}).first;
+            const auto numOutside = windowBegin.index();
+            if (exact) {
+                if (numOutside > 0) {
+                    events = events.mid(numOutside);
+                    numDropped[i] = numOutside;
+                }
+            } else if (numOutside >= events.size() - numOutside) {
+                numDropped[i] = events.removeLeading(numOutside);
+            }
+            anyDropped = anyDropped || numDropped[i] > 0;
+        }
+        if (!anyDropped) {
+            return;
+        }
+
+        // the cpus reference the events by their index, which shifts along
+        for (auto& cpu : eventResult.cpus) {
+            auto isDropped = [&numDropped](const Data::EventIndex& index) {
+                return index.event < numDropped[index.thread];
+            };
+            auto it = std::remove_if(cpu.events.begin(), cpu.events.end(), isDropped);
+            cpu.events.erase(it, cpu.events.end());
+            for (auto& index : cpu.events) {
+                index.event -= numDropped[index.thread];
+            }
+        }
+    }
+
     qint32 addCostType(const QString& label, Data::Costs::Unit unit)
     {
         auto costId = m_nextCostId;
@@ -863,25 +1455,32 @@ public:
         attributes.push_back(attributesDefinition);
     }
 
-    Data::ThreadEvents* addThread(const Record& record)
+    // when we encounter a thread without a ThreadStart event, it was probably alive when
+    // we started the application, then pass the application start as @p startTime
+    Data::ThreadEvents* addThread(const Record& record, quint64 startTime)
     {
         Data::ThreadEvents thread;
         thread.pid = record.pid;
         thread.tid = record.tid;
-        // when we encounter a thread the first time it was probably alive when
-        // we started the application, otherwise we override the start time when
-        // we encounter a ThreadStart event
-        thread.time.start = applicationTime.start;
+        thread.time.start = startTime;
         thread.name = commands.value(thread.pid).value(thread.tid);
         if (thread.name.isEmpty() && thread.pid != thread.tid)
             thread.name = commands.value(thread.pid).value(thread.pid);
+        threadIndices.insert(thread.pid, thread.tid, thread.time.start, eventResult.threads.size());
         eventResult.threads.push_back(thread);
         return &eventResult.threads.last();
     }
 
+    // a reused pid and tid resolve to the thread that was alive at the time of the @p record
+    Data::ThreadEvents* findThread(const Record& record)
+    {
+        const auto index = threadIndices.find(record.pid, record.tid, record.time);
+        return index == -1 ? nullptr : &eventResult.threads[index];
+    }
+
     void addThreadEnd(const ThreadEnd& threadEnd)
     {
-        auto* thread = eventResult.findThread(threadEnd.pid, threadEnd.tid);
+        auto* thread = findThread(threadEnd);
         if (thread) {
             thread->time.end = threadEnd.time;
         }
@@ -891,7 +1490,7 @@ public:
     {
         const auto& comm = strings.value(command.comm.id);
         // check if this changes the name of a current thread
-        auto* thread = eventResult.findThread(command.pid, command.tid);
+        auto* thread = findThread(command);
         if (thread) {
             thread->name = comm;
         }
@@ -913,6 +1512,7 @@ public:
         bottomUpResult.locations.push_back(
             {location.location.parentLocationId, {location.location.address, locationString}});
         bottomUpResult.symbols.push_back({});
+        bottomUpResult.symbolIds.push_back(Data::INVALID_SYMBOL_ID);
     }
 
     void addSymbol(const SymbolDefinition& symbol)
@@ -924,6 +1524,12 @@ public:
         const auto binaryString = strings.value(symbol.symbol.binary.id);
         const auto pathString = strings.value(symbol.symbol.path.id);
         bottomUpResult.symbols[symbol.id] = {symbolString, binaryString, pathString};
+        const auto symbolId = internSymbol(bottomUpResult.symbols[symbol.id]);
+        bottomUpResult.symbolIds[symbol.id] = symbolId;
+        if (symbolId != Data::INVALID_SYMBOL_ID) {
+            // share the interned symbol, including its prettified name
+            bottomUpResult.symbols[symbol.id] = bottomUpResult.symbolTable[symbolId];
+        }
 
         // Count total and missing symbols per module for error report
         auto &numSymbols = numSymbolsByModule[symbol.symbol.binary.id];
@@ -933,40 +1539,71 @@ public:
         }
     }
 
+    Data::SymbolId internSymbol(const Data::Symbol& symbol)
+    {
+        if (!symbol.isValid()) {
+            return Data::INVALID_SYMBOL_ID;
+        }
+
+        auto it = symbolIds.find(symbol);
+        if (it == symbolIds.end()) {
+            it = symbolIds.insert(symbol, bottomUpResult.symbolTable.size());
+            // every unique symbol only gets prettified once, the copies of the interned symbol share it
+            auto interned = symbol;
+            interned.internPrettySymbol();
+            bottomUpResult.symbolTable.push_back(interned);
+        }
+        return *it;
+    }
+
     qint32 internStack(const QVector<qint32>& frames)
     {
-        auto& id = stacks[frames];
-        if (!id) {
-            Q_ASSERT(stacks.size() == eventResult.stacks.size() + 1);
-            id = stacks.size();
-            eventResult.stacks.push_back(frames);
+        auto& nodes = eventResult.stacks;
+        if (nodes.isEmpty()) {
+            nodes.push_back({});
         }
-        return id - 1;
+
+        // walk down from the outermost frame, stacks sharing a common prefix share its nodes
+        qint32 stackId = 0;
+        for (int i = frames.size() - 1; i >= 0; --i) {
+            const auto locationId = frames[i];
+            const auto key = (quint64(quint32(stackId)) << 32) | quint32(locationId);
+            // the root is never a child, so zero marks a new node
+            auto& child = stackChildren[key];
+            if (!child) {
+                child = nodes.size();
+                nodes.push_back({stackId, locationId});
+            }
+            stackId = child;
+        }
+        return stackId;
     }
 
     void addSample(const Sample& sample)
     {
-        auto* thread = eventResult.findThread(sample.pid, sample.tid);
+        auto* thread = findThread(sample);
         if (!thread) {
-            thread = addThread(sample);
+            thread = addThread(sample, applicationTime.start);
         }
         if (static_cast<uint>(eventResult.cpus.size()) <= sample.cpu) {
             eventResult.cpus.resize(sample.cpu + 1);
         }
         auto& cpu = eventResult.cpus[sample.cpu];
+        const auto threadIndex = static_cast<qint32>(thread - eventResult.threads.constData());
+        const auto stackId = internStack(sample.frames);
 
         for (const auto& sampleCost : sample.costs) {
             Data::Event event;
             event.time = sample.time;
             event.cost = sampleCost.cost;
             event.type = attributeIdsToCostIds.value(sampleCost.attributeId, -1);
-            event.stackId = internStack(sample.frames);
+            event.stackId = stackId;
             event.cpuId = sample.cpu;
+            cpu.events.push_back({threadIndex, thread->events.size()});
             thread->events.push_back(event);
-            cpu.events.push_back(event);
         }
 
-        addSampleToBottomUp(sample);
+        addSampleToBottomUp(sample, stackId);
         addSampleToSummary(sample);
     }
 
@@ -976,59 +1613,48 @@ public:
         strings.push_back(QString::fromUtf8(string.string));
     }
 
-    void addSampleToBottomUp(const Sample& sample)
+    void addSampleToBottomUp(const Sample& sample, qint32 stackId)
     {
-        // TODO: optimize for groups, don't repeat the same lookup multiple times
         for (const auto& sampleCost : sample.costs) {
-            addSampleToBottomUp(sample, sampleCost);
-        }
-    }
-
-    void addSampleToBottomUp(const Sample& sample, const SampleCost& sampleCost)
-    {
-        if (perfScriptOutput) {
-            *perfScriptOutput << commands.value(sample.pid).value(sample.pid) << '\t' << sample.pid << '\t'
-                              << sample.time / 1000000000 << '.' << qSetFieldWidth(9) << qSetPadChar(QLatin1Char('0'))
-                              << sample.time % 1000000000 << qSetFieldWidth(0) << ":\t" << sampleCost.cost << ' '
-                              << strings.value(attributes.value(sampleCost.attributeId).name.id) << '\n';
-        }
-
-        QSet<Data::Symbol> recursionGuard;
-        const auto type = attributeIdsToCostIds.value(sampleCost.attributeId, -1);
+            // the summary line gets written for unknown attributes too, like perf script does
+            if (perfScriptOutput) {
+                addPerfScriptSummary(sample, sampleCost);
+            }
 
-        if (type < 0) {
-            qCWarning(LOG_PERFPARSER) << "Unexpected attribute id:" << sampleCost.attributeId << "Only know about"
-                                      << attributeIdsToCostIds.size() << "attributes so far";
-            return;
-        }
+            const auto type = attributeIdsToCostIds.value(sampleCost.attributeId, -1);
 
-        auto frameCallback = [this, &recursionGuard, &sampleCost, type](const Data::Symbol& symbol,
-                                                                        const Data::Location& location) {
-            addCallerCalleeEvent(symbol, location, type, sampleCost.cost, &recursionGuard, &callerCalleeResult,
-                                 bottomUpResult.costs.numTypes());
+            if (type < 0) {
+                qCWarning(LOG_PERFPARSER) << "Unexpected attribute id:" << sampleCost.attributeId << "Only know about"
+                                          << attributeIdsToCostIds.size() << "attributes so far";
+                continue;
+            }
 
             if (perfScriptOutput) {
-                *perfScriptOutput << '\t' << hex << qSetFieldWidth(16) << location.address << qSetFieldWidth(0) << dec
-                                  << ' ' << (symbol.symbol.isEmpty() ? QStringLiteral("[unknown]") : symbol.symbol)
-                                  << " (" << symbol.binary << ")\n";
+                addPerfScriptFrames(sample);
             }
-        };
-
-        bottomUpResult.addEvent(type, sampleCost.cost, sample.frames, frameCallback);
 
-        if (perfScriptOutput) {
-            *perfScriptOutput << "\n";
+            stackCosts.add(stackId, type, sampleCost.cost);
         }
     }
 
-    void buildTopDownResult()
+    void addPerfScriptSummary(const Sample& sample, const SampleCost& sampleCost)
     {
-        topDownResult = Data::TopDownResults::fromBottomUp(bottomUpResult);
+        *perfScriptOutput << commands.value(sample.pid).value(sample.pid) << '\t' << sample.pid << '\t'
+                          << sample.time / 1000000000 << '.' << qSetFieldWidth(9) << qSetPadChar(QLatin1Char('0'))
+                          << sample.time % 1000000000 << qSetFieldWidth(0) << ":\t" << sampleCost.cost << ' '
+                          << strings.value(attributes.value(sampleCost.attributeId).name.id) << '\n';
     }
 
-    void buildCallerCalleeResult()
+    void addPerfScriptFrames(const Sample& sample)
     {
-        Data::callerCalleesFromBottomUpData(bottomUpResult, &callerCalleeResult);
+        bottomUpResult.foreachFrame(sample.frames, [this](const Data::Symbol& symbol, const Data::Location& location) {
+            *perfScriptOutput << '\t' << hex << qSetFieldWidth(16) << location.address << qSetFieldWidth(0) << dec << ' '
+                              << (symbol.symbol.isEmpty() ? QStringLiteral("[unknown]") : symbol.symbol) << " ("
+                              << symbol.binary << ")\n";
+            return true;
+        });
+
+        *perfScriptOutput << "\n";
     }
 
     void addRecord(const Record& record)
@@ -1063,7 +1689,7 @@ public:
 
     void addContextSwitch(const ContextSwitchDefinition& contextSwitch)
     {
-        auto* thread = eventResult.findThread(contextSwitch.pid, contextSwitch.tid);
+        auto* thread = findThread(contextSwitch);
         if (!thread) {
             return;
         }
@@ -1081,22 +1707,17 @@ public:
             totalCost.totalPeriod += switchTime;
 
             qint32 stackId = -1;
-            if (!thread->events.isEmpty() && m_schedSwitchCostId != -1) {
-                auto it = std::find_if(thread->events.rbegin(), thread->events.rend(),
-                                       [this](const Data::Event& event) { return event.type == m_schedSwitchCostId; });
-                if (it != thread->events.rend()) {
-                    stackId = it->stackId;
+            if (m_schedSwitchCostId != -1) {
+                const auto& events = thread->events;
+                for (int i = events.size() - 1; i >= 0; --i) {
+                    if (events.type(i) == m_schedSwitchCostId) {
+                        stackId = events.stackId(i);
+                        break;
+                    }
                 }
             }
             if (stackId != -1) {
-                const auto& frames = eventResult.stacks[stackId];
-                QSet<Data::Symbol> recursionGuard;
-                auto frameCallback = [this, &recursionGuard, switchTime](const Data::Symbol& symbol,
-                                                                         const Data::Location& location) {
-                    addCallerCalleeEvent(symbol, location, eventResult.offCpuTimeCostId, switchTime, &recursionGuard,
-                                         &callerCalleeResult, bottomUpResult.costs.numTypes());
-                };
-                bottomUpResult.addEvent(eventResult.offCpuTimeCostId, switchTime, frames, frameCallback);
+                stackCosts.add(stackId, eventResult.offCpuTimeCostId, switchTime);
             }
 
             Data::Event event;
@@ -1105,13 +1726,47 @@ public:
             event.type = eventResult.offCpuTimeCostId;
             event.stackId = stackId;
             event.cpuId = contextSwitch.cpu;
-            thread->events.push_back(event);
+
+            // the event starts at the switch out, keep the events sorted when samples got recorded since then
+            auto& events = thread->events;
+            auto pos = events.size();
+            while (pos > 0 && events.time(pos - 1) > event.time) {
+                --pos;
+            }
+            if (pos == events.size()) {
+                events.push_back(event);
+            } else {
+                shiftCpuEvents(static_cast<qint32>(thread - eventResult.threads.constData()), pos);
+                events.insert(pos, event);
+            }
         }
 
         thread->lastSwitchTime = contextSwitch.time;
         thread->state = contextSwitch.switchOut ? Data::ThreadEvents::OffCpu : Data::ThreadEvents::OnCpu;
     }
 
+    // the cpus reference the events by their index, move these for the events of the thread from @p pos on
+    void shiftCpuEvents(qint32 threadIndex, int pos)
+    {
+        const auto& events = eventResult.threads[threadIndex].events;
+        for (int i = events.size() - 1; i >= pos; --i) {
+            // only the samples are referenced, not the off-CPU events
+            const auto cpuId = events.cpuId(i);
+            if (events.type(i) == eventResult.offCpuTimeCostId
+                || cpuId >= static_cast<quint32>(eventResult.cpus.size())) {
+                continue;
+            }
+            auto& cpuEvents = eventResult.cpus[cpuId].events;
+            auto isEvent = [threadIndex, i](const Data::EventIndex& index) {
+                return index.thread == threadIndex && index.event == i;
+            };
+            auto it = std::find_if(cpuEvents.rbegin(), cpuEvents.rend(), isEvent);
+            if (it != cpuEvents.rend()) {
+                ++it->event;
+            }
+        }
+    }
+
     void addLost(const LostDefinition& /*lost*/)
     {
         ++summaryResult.lostChunks;
@@ -1154,38 +1809,15 @@ public:
         }
     }
 
-    enum State
-    {
-        HEADER,
-        DATA_STREAM_VERSION,
-        EVENT_HEADER,
-        EVENT,
-        PARSE_ERROR
-    };
-
-    enum class EventType {
-        ThreadStart,
-        ThreadEnd,
-        Command,
-        LocationDefinition,
-        SymbolDefinition,
-        StringDefinition,
-        LostDefinition,
-        FeaturesDefinition,
-        Error,
-        Progress,
-        TracePointFormat,
-        AttributesDefinition,
-        ContextSwitchDefinition,
-        Sample,
-        TracePointSample,
-        InvalidType
-    };
+    static const constexpr int BUFFER_SIZE = 1024 * 1024;
 
     State state = HEADER;
     quint32 eventSize = 0;
-    QBuffer buffer;
-    QDataStream stream;
+    qint32 dataStreamVersion = 0;
+    QByteArray buffer;
+    qint64 bufferPos = 0;
+    // reused for every sample event to prevent repeated allocations
+    Sample currentSample;
     QVector<AttributesDefinition> attributes;
     QVector<QString> strings;
     QProcess process;
@@ -1197,12 +1829,23 @@ public:
     Data::TopDownResults topDownResult;
     Data::CallerCalleeResults callerCalleeResult;
     Data::EventResults eventResult;
+    // looks up the threads in eventResult by pid and tid
+    Data::ThreadIndex threadIndices;
+    StackHistogram stackCosts;
     QHash<qint32, QHash<qint32, QString>> commands;
     QScopedPointer<QTextStream> perfScriptOutput;
     QHash<qint32, SymbolCount> numSymbolsByModule;
     QSet<QString> encounteredErrors;
-    QHash<QVector<qint32>, qint32> stacks;
+    // maps the parent node and location id of a frame to its node in eventResult.stacks
+    QHash<quint64, qint32> stackChildren;
+    QHash<Data::Symbol, Data::SymbolId> symbolIds;
     std::atomic<bool> stopRequested;
+    // in msecs, zero when no partial results should be published
+    int partialResultsInterval = 0;
+    // in nsecs, zero unless profiling live, see buildPartialResults
+    quint64 liveWindow = 0;
+    QElapsedTimer partialResultsTimer;
+    qint64 nextPartialResults = 0;
     QHash<qint32, qint32> attributeIdsToCostIds;
     QHash<int, qint32> attributeNameToCostIds;
     qint32 m_nextCostId = 0;
@@ -1219,27 +1862,40 @@ signals:
     void progress(float percent);
 };
 
+static QStringList parserArguments(const QString& sysroot, const QString& kallsyms, const QString& debugPaths,
+                                   const QString& extraLibPaths, const QString& appPath, const QString& arch)
+{
+    QStringList parserArgs = {QStringLiteral("--max-frames"), QStringLiteral("1024")};
+    if (!sysroot.isEmpty()) {
+        parserArgs += {QStringLiteral("--sysroot"), sysroot};
+    }
+    if (!kallsyms.isEmpty()) {
+        parserArgs += {QStringLiteral("--kallsyms"), kallsyms};
+    }
+    if (!debugPaths.isEmpty()) {
+        parserArgs += {QStringLiteral("--debug"), debugPaths};
+    }
+    if (!extraLibPaths.isEmpty()) {
+        parserArgs += {QStringLiteral("--extra"), extraLibPaths};
+    }
+    if (!appPath.isEmpty()) {
+        parserArgs += {QStringLiteral("--app"), appPath};
+    }
+    if (!arch.isEmpty()) {
+        parserArgs += {QStringLiteral("--arch"), arch};
+    }
+    return parserArgs;
+}
+
 PerfParser::PerfParser(QObject* parent)
     : QObject(parent)
     , m_isParsing(false)
     , m_stopRequested(false)
+    , m_filterGeneration(0)
+    , m_partialResultsInterval(0)
 {
-    // set data via signal/slot connection to ensure we don't introduce a data race
-    connect(this, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
-        if (m_bottomUpResults.root.children.isEmpty()) {
-            m_bottomUpResults = data;
-        }
-    });
-    connect(this, &PerfParser::callerCalleeDataAvailable, this, [this](const Data::CallerCalleeResults& data) {
-        if (m_callerCalleeResults.entries.isEmpty()) {
-            m_callerCalleeResults = data;
-        }
-    });
-    connect(this, &PerfParser::eventsAvailable, this, [this](const Data::EventResults& data) {
-        if (m_events.threads.isEmpty()) {
-            m_events = data;
-        }
-    });
+    setFilterCacheLimit(512 * 1024);
+
     connect(this, &PerfParser::parsingStarted, this, [this]() {
         m_isParsing = true;
         m_stopRequested = false;
@@ -1270,6 +1926,46 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
         return;
     }
 
+    const auto parserArgs = QStringList {QStringLiteral("--input"), path}
+        + parserArguments(sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch);
+    startParser(parserArgs, 0);
+}
+
+void PerfParser::startParseLive(quint64 window, const QString& sysroot, const QString& kallsyms,
+                                const QString& debugPaths, const QString& extraLibPaths, const QString& appPath,
+                                const QString& arch)
+{
+    Q_ASSERT(!m_isParsing);
+    Q_ASSERT(window > 0);
+
+    {
+        QMutexLocker locker(&m_liveInputMutex);
+        m_liveInput.clear();
+        m_liveInputFinished = false;
+    }
+
+    // without an input file, the parser reads the data from stdin
+    startParser(parserArguments(sysroot, kallsyms, debugPaths, extraLibPaths, appPath, arch), window);
+}
+
+void PerfParser::addLiveData(const QByteArray& data)
+{
+    QMutexLocker locker(&m_liveInputMutex);
+    m_liveInput += data;
+    locker.unlock();
+    emit liveInputAvailable();
+}
+
+void PerfParser::finishLiveData()
+{
+    QMutexLocker locker(&m_liveInputMutex);
+    m_liveInputFinished = true;
+    locker.unlock();
+    emit liveInputAvailable();
+}
+
+void PerfParser::startParser(const QStringList& parserArgs, quint64 liveWindow)
+{
     auto parserBinary = QString::fromLocal8Bit(qgetenv("HOTSPOT_PERFPARSER"));
     if (parserBinary.isEmpty()) {
         parserBinary = Util::findLibexecBinary(QStringLiteral("hotspot-perfparser"));
@@ -1279,41 +1975,55 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
         return;
     }
 
-    QStringList parserArgs = {QStringLiteral("--input"), path, QStringLiteral("--max-frames"), QStringLiteral("1024")};
-    if (!sysroot.isEmpty()) {
-        parserArgs += {QStringLiteral("--sysroot"), sysroot};
-    }
-    if (!kallsyms.isEmpty()) {
-        parserArgs += {QStringLiteral("--kallsyms"), kallsyms};
-    }
-    if (!debugPaths.isEmpty()) {
-        parserArgs += {QStringLiteral("--debug"), debugPaths};
-    }
-    if (!extraLibPaths.isEmpty()) {
-        parserArgs += {QStringLiteral("--extra"), extraLibPaths};
-    }
-    if (!appPath.isEmpty()) {
-        parserArgs += {QStringLiteral("--app"), appPath};
-    }
-    if (!arch.isEmpty()) {
-        parserArgs += {QStringLiteral("--arch"), arch};
-    }
-
     // reset the data to ensure filtering will pick up the new data
-    m_bottomUpResults = {};
-    m_callerCalleeResults = {};
-    m_events = {};
+    m_bottomUpResults.reset();
+    m_callerCalleeResults.reset();
+    m_events.reset();
+    m_lastFilter = {};
+    m_lastFilterEvents.reset();
+    m_pendingFilter = {};
+    m_hasPendingFilter = false;
+    m_filterCache.clear();
+    // cancel any filter job that may still be running on the old data
+    ++m_filterGeneration;
 
     emit parsingStarted();
     using namespace ThreadWeaver;
-    stream() << make_job([parserBinary, parserArgs, this]() {
+    stream() << make_job([parserBinary, parserArgs, liveWindow, this]() {
         PerfParserPrivate d;
         connect(&d, &PerfParserPrivate::progress, this, &PerfParser::progress);
         connect(this, &PerfParser::stopRequested, &d, &PerfParserPrivate::stop);
+        d.partialResultsInterval = m_partialResultsInterval;
+        d.liveWindow = liveWindow;
+        if (liveWindow && !d.partialResultsInterval) {
+            // live results are pointless without updates, and only these trim the events
+            d.partialResultsInterval = 1000;
+        }
 
-        connect(&d.process, &QProcess::readyRead, &d.process, [&d] {
+        auto publishPartialResults = [&d, this]() {
+            Data::BottomUpResults bottomUp;
+            Data::TopDownResults topDown;
+            Data::Summary summary;
+            Data::EventResults events;
+            // the events are only bounded by the window when profiling live, otherwise they are too costly to copy
+            d.buildPartialResults(&bottomUp, &topDown, &summary, d.liveWindow ? &events : nullptr);
+            if (m_stopRequested) {
+                return;
+            }
+            emit bottomUpDataAvailable(Data::makeSnapshot(std::move(bottomUp)));
+            emit topDownDataAvailable(Data::makeSnapshot(std::move(topDown)));
+            emit summaryDataAvailable(summary);
+            if (d.liveWindow) {
+                emit eventsAvailable(Data::makeSnapshot(std::move(events)));
+            }
+            emit partialResultsAvailable();
+        };
+
+        connect(&d.process, &QProcess::readyRead, &d.process, [&d, &publishPartialResults] {
             while (d.tryParse()) {
-                // just call tryParse until it fails
+                if (d.partialResultsDue()) {
+                    publishPartialResults();
+                }
             }
         });
 
@@ -1337,15 +2047,35 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
                         InvalidOption
                     };
                     switch (exitCode) {
-                    case NoError:
+                    case NoError: {
                         d.finalize();
-                        emit bottomUpDataAvailable(d.bottomUpResult);
-                        emit topDownDataAvailable(d.topDownResult);
+                        // publish the results once, all receivers share them from here on
+                        const auto bottomUp = Data::makeSnapshot(std::move(d.bottomUpResult));
+                        const auto callerCallee = Data::makeSnapshot(std::move(d.callerCalleeResult));
+                        const auto events = Data::makeSnapshot(std::move(d.eventResult));
+                        // remember the unfiltered results on the main thread, the base for all filters
+                        QMetaObject::invokeMethod(this, [this, bottomUp, callerCallee, events]() {
+                            m_bottomUpResults = bottomUp;
+                            m_callerCalleeResults = callerCallee;
+                            m_events = events;
+                        }, Qt::QueuedConnection);
+
+                        emit bottomUpDataAvailable(bottomUp);
+                        emit topDownDataAvailable(Data::makeSnapshot(std::move(d.topDownResult)));
                         emit summaryDataAvailable(d.summaryResult);
-                        emit callerCalleeDataAvailable(d.callerCalleeResult);
-                        emit eventsAvailable(d.eventResult);
+                        emit callerCalleeDataAvailable(callerCallee);
+                        emit eventsAvailable(events);
                         emit parsingFinished();
+
+                        // queued after the signals above, such that the filtered results come last
+                        QMetaObject::invokeMethod(this, [this]() {
+                            if (m_hasPendingFilter) {
+                                m_hasPendingFilter = false;
+                                filterResults(m_pendingFilter);
+                            }
+                        }, Qt::QueuedConnection);
                         break;
+                    }
                     case TcpSocketError:
                         emit parsingFailed(
                             tr("The hotspot-perfparser binary exited with code %1 (TCP socket error).").arg(exitCode));
@@ -1389,6 +2119,22 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
             emit parsingFailed(tr("Failed to start the hotspot-perfparser process"));
             return;
         }
+        d.partialResultsTimer.start();
+        d.nextPartialResults = d.partialResultsInterval;
+
+        if (liveWindow) {
+            // forward the data that got recorded so far, and from then on whenever new data arrives
+            auto writeLiveInput = [&d, this]() {
+                QMutexLocker locker(&m_liveInputMutex);
+                d.process.write(m_liveInput);
+                m_liveInput.clear();
+                if (m_liveInputFinished) {
+                    d.process.closeWriteChannel();
+                }
+            };
+            connect(this, &PerfParser::liveInputAvailable, &d.process, writeLiveInput);
+            writeLiveInput();
+        }
 
         QEventLoop loop;
         connect(&d.process, static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished), &loop,
@@ -1399,14 +2145,59 @@ void PerfParser::startParseFile(const QString& path, const QString& sysroot, con
 
 void PerfParser::filterResults(const Data::FilterAction& filter)
 {
-    Q_ASSERT(!m_isParsing);
+    if (!m_bottomUpResults || !m_callerCalleeResults || !m_events) {
+        // still parsing, only the newest filter matters once the results are there
+        m_pendingFilter = filter;
+        m_hasPendingFilter = true;
+        return;
+    }
+
+    // supersede any filter job that is still running, only the newest result gets emitted
+    const auto generation = ++m_filterGeneration;
+
+    if (auto cached = m_filterCache.object(filter)) {
+        ++m_filterCacheHits;
+        qCDebug(LOG_PERFPARSER) << "filter cache hit:" << m_filterCacheHits << "hits," << m_filterCacheMisses
+                                << "misses," << m_filterCache.totalCost() << "KiB used";
+
+        m_lastFilter = filter;
+        m_lastFilterEvents = cached->events;
+
+        emit parsingStarted();
+        emit bottomUpDataAvailable(cached->bottomUp);
+        emit topDownDataAvailable(cached->topDown);
+        emit callerCalleeDataAvailable(cached->callerCallee);
+        emit eventsAvailable(cached->events);
+        emit parsingFinished();
+        return;
+    }
+    ++m_filterCacheMisses;
+
+    // when the filter only narrows down the last one, we can start from the already filtered events
+    const bool isRefinement = m_lastFilter.isValid() && filter.isRefinementOf(m_lastFilter);
+    const auto baseEvents = isRefinement ? m_lastFilterEvents : m_events;
+    // the job holds on to the snapshots, which stay valid even when a new file gets parsed meanwhile
+    const auto allBottomUp = m_bottomUpResults;
+    const auto allCallerCallee = m_callerCalleeResults;
+    const auto allEvents = m_events;
 
     emit parsingStarted();
     using namespace ThreadWeaver;
-    stream() << make_job([this, filter]() {
+    stream() << make_job([this, filter, baseEvents, allBottomUp, allCallerCallee, allEvents, generation]() {
+        // true once the user stopped filtering or a newer filter superseded this one
+        auto isCancelled = [this, generation]() { return m_stopRequested || m_filterGeneration != generation; };
+        // superseded jobs silently make way for the newer one, only report explicit stops
+        auto reportCancellation = [this]() {
+            if (m_stopRequested) {
+                emit parsingFailed(tr("Parsing stopped."));
+            }
+        };
+
         Data::BottomUpResults bottomUp;
-        Data::EventResults events = m_events;
+        Data::EventResults events = *baseEvents;
         Data::CallerCalleeResults callerCallee;
+        Data::TopDownResults topDown;
+        StackHistogram stackCosts;
         const bool filterByTime = filter.time.isValid();
         const bool filterByCpu = filter.cpuId != std::numeric_limits<quint32>::max();
         const bool excludeByCpu = !filter.excludeCpuIds.isEmpty();
@@ -1415,14 +2206,17 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
         const bool filterByStack = includeBySymbol || excludeBySymbol;
 
         if (!filter.isValid()) {
-            bottomUp = m_bottomUpResults;
-            callerCallee = m_callerCalleeResults;
+            bottomUp = *allBottomUp;
+            callerCallee = *allCallerCallee;
+            // the caller callee data is unfiltered too, only the top down tree is missing
+            topDown = Data::TopDownResults::fromBottomUp(bottomUp);
         } else {
-            bottomUp.symbols = m_bottomUpResults.symbols;
-            bottomUp.locations = m_bottomUpResults.locations;
-            bottomUp.costs.initializeCostsFrom(m_bottomUpResults.costs);
+            bottomUp.symbols = allBottomUp->symbols;
+            bottomUp.symbolIds = allBottomUp->symbolIds;
+            bottomUp.symbolTable = allBottomUp->symbolTable;
+            bottomUp.locations = allBottomUp->locations;
+            bottomUp.costs.initializeCostsFrom(allBottomUp->costs);
             bottomUp.costs.clearTotalCost();
-            const int numCosts = m_bottomUpResults.costs.numTypes();
 
             // rebuild per-CPU data, i.e. wipe all the events and then re-add them
             for (auto& cpu : events.cpus) {
@@ -1433,118 +2227,243 @@ void PerfParser::filterResults(const Data::FilterAction& filter)
             // included, which is hopefully less work than filtering the stack for every event
             QVector<bool> filterStacks;
             if (filterByStack) {
-                filterStacks.resize(m_events.stacks.size());
-                // TODO: parallelize
-                for (qint32 stackId = 0, c = m_events.stacks.size(); stackId < c; ++stackId) {
-                    // if empty, then all include filters are matched
-                    auto included = filter.includeSymbols;
-                    // if false, then none of the exclude filters matched
-                    bool excluded = false;
-                    m_bottomUpResults.foreachFrame(m_events.stacks.at(stackId), [&included, &excluded, &filter](const Data::Symbol& symbol, const Data::Location& /*location*/){
-                        excluded = filter.excludeSymbols.contains(symbol);
-                        if (excluded) {
-                            return false;
+                // resolve the symbols once, such that we only need to compare ids below
+                auto toSymbolIds = [&allBottomUp](const QSet<Data::Symbol>& symbols) {
+                    QSet<Data::SymbolId> symbolIds;
+                    if (symbols.contains(Data::Symbol())) {
+                        symbolIds.insert(Data::INVALID_SYMBOL_ID);
+                    }
+                    const auto& symbolTable = allBottomUp->symbolTable;
+                    for (Data::SymbolId symbolId = 0, c = symbolTable.size(); symbolId < c; ++symbolId) {
+                        if (symbols.contains(symbolTable[symbolId])) {
+                            symbolIds.insert(symbolId);
+                        }
+                    }
+                    return symbolIds;
+                };
+                const auto includeSymbolIds = toSymbolIds(filter.includeSymbols);
+                const auto excludeSymbolIds = toSymbolIds(filter.excludeSymbols);
+                // an include filter for an unknown symbol can never be matched
+                const bool canMatch = includeSymbolIds.size() == filter.includeSymbols.size();
+
+                const auto& nodes = allEvents->stacks;
+                filterStacks.resize(nodes.size());
+                if (canMatch && !nodes.isEmpty()) {
+                    // every node of the stack tree inherits the state of its parent, which always
+                    // precedes it. that way every frame only gets looked at once for all stacks
+                    QHash<Data::SymbolId, int> includeBits;
+                    for (auto symbolId : includeSymbolIds) {
+                        includeBits.insert(symbolId, includeBits.size());
+                    }
+                    const int numWords = (includeBits.size() + 63) / 64;
+                    // one bit per matched include filter, and the number of matched filters per node
+                    QVector<quint64> matchedBits(nodes.size() * numWords);
+                    QVector<int> numMatched(nodes.size());
+                    QVector<bool> excluded(nodes.size());
+
+                    filterStacks[0] = includeBits.isEmpty();
+                    for (qint32 stackId = 1, c = nodes.size(); stackId < c; ++stackId) {
+                        if (stackId % 1024 == 0 && isCancelled()) {
+                            break;
+                        }
+
+                        const auto parent = nodes[stackId].parent;
+                        bool isExcluded = excluded[parent];
+                        if (!isExcluded) {
+                            auto* bits = matchedBits.data() + stackId * numWords;
+                            std::copy_n(matchedBits.constData() + parent * numWords, numWords, bits);
+                            auto matched = numMatched[parent];
+                            allBottomUp->foreachFrameSymbolId(
+                                nodes[stackId].locationId,
+                                [&](Data::SymbolId symbolId, const Data::Location& /*location*/) {
+                                    if (excludeSymbolIds.contains(symbolId)) {
+                                        isExcluded = true;
+                                        return false;
+                                    }
+                                    const auto bit = includeBits.value(symbolId, -1);
+                                    if (bit != -1 && !(bits[bit / 64] & (quint64(1) << (bit % 64)))) {
+                                        bits[bit / 64] |= quint64(1) << (bit % 64);
+                                        ++matched;
+                                    }
+                                    return true;
+                                });
+                            numMatched[stackId] = matched;
                         }
-                        included.remove(symbol);
-                        // only stop when we included everything and no exclude filter is set
-                        return !included.isEmpty() || !filter.excludeSymbols.isEmpty();
-                    });
-                    filterStacks[stackId] = !excluded && included.isEmpty();
+                        excluded[stackId] = isExcluded;
+                        filterStacks[stackId] = !isExcluded && numMatched[stackId] == includeBits.size();
+                    }
                 }
             }
 
-            // remove events that lie outside the selected time span
-            // TODO: parallelize
-            for (auto& thread : events.threads) {
-                if (m_stopRequested) {
-                    emit parsingFailed(tr("Parsing stopped."));
-                    return;
-                }
+            // remove events that lie outside the selected time span, every thread is filtered in parallel
+            // the events of the threads are shared with the snapshot, we only copy the ones that pass the filter
+            auto* threads = events.threads.data();
+            parallelForChunks(events.threads.size(), 1, [&](int begin, int end) {
+                for (int i = begin; i < end; ++i) {
+                    if (isCancelled()) {
+                        return;
+                    }
 
-                if ((filter.processId != Data::INVALID_PID && thread.pid != filter.processId)
-                    || (filter.threadId != Data::INVALID_TID && thread.tid != filter.threadId)
-                    || (filterByTime && (thread.time.start > filter.time.end || thread.time.end < filter.time.start))
-                    || filter.excludeProcessIds.contains(thread.pid) || filter.excludeThreadIds.contains(thread.tid)) {
-                    thread.events.clear();
-                    continue;
-                }
+                    auto& thread = threads[i];
+                    if ((filter.processId != Data::INVALID_PID && thread.pid != filter.processId)
+                        || (filter.threadId != Data::INVALID_TID && thread.tid != filter.threadId)
+                        || (filterByTime && (thread.time.start > filter.time.end || thread.time.end < filter.time.start))
+                        || filter.excludeProcessIds.contains(thread.pid) || filter.excludeThreadIds.contains(thread.tid)) {
+                        thread.events.clear();
+                        continue;
+                    }
 
-                if (filterByTime || filterByCpu || excludeByCpu || filterByStack) {
-                    auto it = std::remove_if(
-                        thread.events.begin(), thread.events.end(),
-                        [filter, filterByTime, filterByCpu, excludeByCpu, filterByStack, filterStacks](const Data::Event& event) {
-                            if (filterByTime && !filter.time.contains(event.time)) {
-                                return true;
-                            } else if (filterByCpu && event.cpuId != filter.cpuId) {
-                                return true;
-                            } else if (excludeByCpu && filter.excludeCpuIds.contains(event.cpuId)) {
-                                return true;
-                            } else if (filterByStack && !filterStacks[event.stackId]) {
-                                return true;
+                    // the events are sorted by time, so only look at the ones within the time range
+                    const auto& allEvents = thread.events;
+                    auto eventsBegin = allEvents.begin();
+                    auto eventsEnd = allEvents.end();
+                    if (filterByTime) {
+                        std::tie(eventsBegin, eventsEnd) = Data::findEventsInTimeRange(allEvents, filter.time);
+                    }
+
+                    if (filterByCpu || excludeByCpu || filterByStack) {
+                        // only look at the columns we filter by, the full event is only decoded when it passes
+                        Data::Events filtered;
+                        for (int j = eventsBegin.index(), c = eventsEnd.index(); j < c; ++j) {
+                            const auto cpuId = allEvents.cpuId(j);
+                            if (filterByCpu && cpuId != filter.cpuId) {
+                                continue;
+                            } else if (excludeByCpu && filter.excludeCpuIds.contains(cpuId)) {
+                                continue;
+                            } else if (filterByStack && !filterStacks[allEvents.stackId(j)]) {
+                                continue;
                             }
-                            return false;
-                        });
-                    thread.events.erase(it, thread.events.end());
+                            filtered.push_back(allEvents.at(j));
+                        }
+                        thread.events = std::move(filtered);
+                    } else if (eventsBegin != allEvents.begin() || eventsEnd != allEvents.end()) {
+                        thread.events = allEvents.mid(eventsBegin.index(), eventsEnd - eventsBegin);
+                    }
                 }
-                if (m_stopRequested) {
-                    emit parsingFailed(tr("Parsing stopped."));
+            });
+
+            if (isCancelled()) {
+                reportCancellation();
+                return;
+            }
+
+            // remove threads that have no events within the selected time span
+            // this has to happen before the cpus reference the events by their thread index
+            auto it = std::remove_if(events.threads.begin(), events.threads.end(),
+                                     [](const Data::ThreadEvents& thread) { return thread.events.isEmpty(); });
+            events.threads.erase(it, events.threads.end());
+
+            for (int i = 0, c = events.threads.size(); i < c; ++i) {
+                if (isCancelled()) {
+                    reportCancellation();
                     return;
                 }
 
-                // add event data to cpus, bottom up and caller callee sets
-                for (const auto& event : thread.events) {
+                // add event data to cpus and the stack histogram
+                const auto& threadEvents = events.threads.at(i).events;
+                for (int j = 0, numEvents = threadEvents.size(); j < numEvents; ++j) {
+                    const auto type = threadEvents.type(j);
                     // only add non-time events to the cpu line, context switches shouldn't show up there
-                    if (event.type != events.offCpuTimeCostId) {
-                        events.cpus[event.cpuId].events.push_back(event);
+                    if (type != events.offCpuTimeCostId) {
+                        events.cpus[threadEvents.cpuId(j)].events.push_back({i, j});
                     }
 
-                    QSet<Data::Symbol> recursionGuard;
-                    auto frameCallback = [&callerCallee, &recursionGuard, &event,
-                                          numCosts](const Data::Symbol& symbol, const Data::Location& location) {
-                        addCallerCalleeEvent(symbol, location, event.type, event.cost, &recursionGuard, &callerCallee,
-                                             numCosts);
-                    };
-
-                    bottomUp.addEvent(event.type, event.cost, events.stacks.at(event.stackId), frameCallback);
+                    // off-CPU events may lack a stack, these are not part of the bottom up data while parsing either
+                    const auto stackId = threadEvents.stackId(j);
+                    if (stackId >= 0 && type >= 0) {
+                        stackCosts.add(stackId, type, threadEvents.cost(j));
+                    }
                 }
             }
 
-            // remove threads that have no events within the selected time span
-            auto it = std::remove_if(events.threads.begin(), events.threads.end(),
-                                     [](const Data::ThreadEvents& thread) { return thread.events.isEmpty(); });
-            events.threads.erase(it, events.threads.end());
+            // the cpus got their events thread by thread, but the timeline reads them sorted by time
+            {
+                const auto& threads = events.threads;
+                auto* cpus = events.cpus.data();
+                auto eventTime = [&threads](const Data::EventIndex& index) {
+                    return threads[index.thread].events.time(index.event);
+                };
+                parallelForChunks(events.cpus.size(), 1, [cpus, &eventTime](int begin, int end) {
+                    for (int i = begin; i < end; ++i) {
+                        auto& cpuEvents = cpus[i].events;
+                        std::stable_sort(cpuEvents.begin(), cpuEvents.end(),
+                                         [&eventTime](const Data::EventIndex& lhs, const Data::EventIndex& rhs) {
+                                             return eventTime(lhs) < eventTime(rhs);
+                                         });
+                    }
+                });
+            }
+
+            // build the bottom up and caller callee sets, walking every unique stack only once
+            aggregateStacks(stackCosts, events, &bottomUp, &callerCallee, isCancelled);
+
+            if (isCancelled()) {
+                reportCancellation();
+                return;
+            }
 
             Data::BottomUp::initializeParents(&bottomUp.root);
 
-            if (m_stopRequested) {
-                emit parsingFailed(tr("Parsing stopped."));
+            if (isCancelled()) {
+                reportCancellation();
                 return;
             }
 
-            // TODO: parallelize
-            Data::callerCalleesFromBottomUpData(bottomUp, &callerCallee);
+            deriveTopDownAndCallerCallee(bottomUp, &topDown, &callerCallee);
         }
 
-        if (m_stopRequested) {
-            emit parsingFailed(tr("Parsing stopped."));
+        if (isCancelled()) {
+            reportCancellation();
             return;
         }
 
-        const auto topDown = Data::TopDownResults::fromBottomUp(bottomUp);
-
-        if (m_stopRequested) {
-            emit parsingFailed(tr("Parsing stopped."));
-            return;
-        }
+        // remember the results on the main thread, to refine them with the next filter
+        // and to get them from the cache when the user returns to this filter
+        const FilterResults results {Data::makeSnapshot(std::move(bottomUp)), Data::makeSnapshot(std::move(topDown)),
+                                     Data::makeSnapshot(std::move(callerCallee)), Data::makeSnapshot(std::move(events))};
+        QMetaObject::invokeMethod(this, [this, filter, results, generation]() {
+            // a newer filter may have been requested after our last check, possibly even served from the cache
+            // already. it must not get overwritten by our stale results, so check again on the main thread
+            if (m_filterGeneration != generation) {
+                return;
+            }
 
-        emit bottomUpDataAvailable(bottomUp);
-        emit topDownDataAvailable(topDown);
-        emit callerCalleeDataAvailable(callerCallee);
-        emit eventsAvailable(events);
-        emit parsingFinished();
+            m_lastFilter = filter;
+            m_lastFilterEvents = results.events;
+            // the cost is the estimated memory usage in KiB
+            const auto cost = static_cast<int>(estimateMemoryUsage(results) / 1024 + 1);
+            m_filterCache.insert(filter, new FilterResults(results), cost);
+
+            emit bottomUpDataAvailable(results.bottomUp);
+            emit topDownDataAvailable(results.topDown);
+            emit callerCalleeDataAvailable(results.callerCallee);
+            emit eventsAvailable(results.events);
+            emit parsingFinished();
+        }, Qt::QueuedConnection);
     });
 }
 
+PerfParser::FilterCacheStatistics PerfParser::filterCacheStatistics() const
+{
+    FilterCacheStatistics statistics;
+    statistics.hits = m_filterCacheHits;
+    statistics.misses = m_filterCacheMisses;
+    statistics.numEntries = m_filterCache.count();
+    statistics.memoryUsage = m_filterCache.totalCost();
+    statistics.memoryLimit = m_filterCache.maxCost();
+    return statistics;
+}
+
+void PerfParser::setFilterCacheLimit(int kibibytes)
+{
+    m_filterCache.setMaxCost(kibibytes);
+}
+
+void PerfParser::setPartialResultsInterval(int msecs)
+{
+    m_partialResultsInterval = msecs;
+}
+
 void PerfParser::stop()
 {
     m_stopRequested = true;
@@ -29,6 +29,8 @@
 
 #include <atomic>
 #include <memory>
+#include <QCache>
+#include <QMutex>
 #include <QObject>
 
 #include <models/data.h>
@@ -44,27 +46,83 @@ public:
     void startParseFile(const QString& path, const QString& sysroot, const QString& kallsyms, const QString& debugPaths,
                         const QString& extraLibPaths, const QString& appPath, const QString& arch);
 
+    // parse the data of a running `perf record -o -` that gets passed to addLiveData, until finishLiveData is called
+    // while parsing, partial results for the last @p window nanoseconds get published, see setPartialResultsInterval
+    // the final results cover the whole recording, but the timeline events only the last window
+    // only the memory used for the events is bounded by the window, the unique stacks and symbols as well as the
+    // threads and their aggregated costs are kept for the whole recording, these grow with the profiled code instead
+    void startParseLive(quint64 window, const QString& sysroot, const QString& kallsyms, const QString& debugPaths,
+                        const QString& extraLibPaths, const QString& appPath, const QString& arch);
+    void addLiveData(const QByteArray& data);
+    void finishLiveData();
+
     void filterResults(const Data::FilterAction& filter);
 
+    struct FilterCacheStatistics
+    {
+        quint64 hits = 0;
+        quint64 misses = 0;
+        int numEntries = 0;
+        // estimated memory usage and limit of the cached results, in KiB
+        int memoryUsage = 0;
+        int memoryLimit = 0;
+    };
+    FilterCacheStatistics filterCacheStatistics() const;
+    void setFilterCacheLimit(int kibibytes);
+
+    // while parsing a file, publish the results parsed so far roughly every @p msecs, 0 disables this
+    // the partial bottom up, top down and summary data is emitted through the usual signals, followed by
+    // partialResultsAvailable, all of them get emitted once more with the complete data when parsing finishes
+    void setPartialResultsInterval(int msecs);
+
     void stop();
 
 signals:
     void parsingStarted();
     void summaryDataAvailable(const Data::Summary& data);
-    void bottomUpDataAvailable(const Data::BottomUpResults& data);
-    void topDownDataAvailable(const Data::TopDownResults& data);
-    void callerCalleeDataAvailable(const Data::CallerCalleeResults& data);
-    void eventsAvailable(const Data::EventResults& events);
+    void bottomUpDataAvailable(const Data::Snapshot<Data::BottomUpResults>& data);
+    void topDownDataAvailable(const Data::Snapshot<Data::TopDownResults>& data);
+    void callerCalleeDataAvailable(const Data::Snapshot<Data::CallerCalleeResults>& data);
+    void eventsAvailable(const Data::Snapshot<Data::EventResults>& events);
+    void partialResultsAvailable();
     void parsingFinished();
     void parsingFailed(const QString& errorMessage);
     void progress(float progress);
     void stopRequested();
+    // notifies the parser job about new data in m_liveInput
+    void liveInputAvailable();
 
 private:
-    // only set once after the initial startParseFile finished
-    Data::BottomUpResults m_bottomUpResults;
-    Data::CallerCalleeResults m_callerCalleeResults;
-    Data::EventResults m_events;
+    void startParser(const QStringList& parserArgs, quint64 liveWindow);
+
+    // only set once after the initial startParseFile finished, partial results never end up here
+    Data::Snapshot<Data::BottomUpResults> m_bottomUpResults;
+    Data::Snapshot<Data::CallerCalleeResults> m_callerCalleeResults;
+    Data::Snapshot<Data::EventResults> m_events;
+    // the last filter and its results, which get refined by narrower filters
+    Data::FilterAction m_lastFilter;
+    Data::Snapshot<Data::EventResults> m_lastFilterEvents;
+    // the newest filter that got requested while parsing, it gets applied once the results are there
+    Data::FilterAction m_pendingFilter;
+    bool m_hasPendingFilter = false;
+    struct FilterResults
+    {
+        Data::Snapshot<Data::BottomUpResults> bottomUp;
+        Data::Snapshot<Data::TopDownResults> topDown;
+        Data::Snapshot<Data::CallerCalleeResults> callerCallee;
+        Data::Snapshot<Data::EventResults> events;
+    };
+    // the results of previous filters, which makes going back and forth between filters instant
+    QCache<Data::FilterAction, FilterResults> m_filterCache;
+    quint64 m_filterCacheHits = 0;
+    quint64 m_filterCacheMisses = 0;
     std::atomic<bool> m_isParsing;
     std::atomic<bool> m_stopRequested;
+    // incremented for every filter request, running filter jobs of older generations get cancelled
+    std::atomic<uint> m_filterGeneration;
+    std::atomic<int> m_partialResultsInterval;
+    // the recorded data that still needs to be passed to the parser job when parsing live
+    QMutex m_liveInputMutex;
+    QByteArray m_liveInput;
+    bool m_liveInputFinished = false;
 };
@@ -50,6 +50,7 @@ PerfRecord::PerfRecord(QObject* parent)
     , m_elevatePrivilegesProcess(nullptr)
     , m_outputPath()
     , m_userTerminated(false)
+    , m_liveOutput(false)
 {
 }
 
@@ -62,6 +63,11 @@ PerfRecord::~PerfRecord()
     }
 }
 
+void PerfRecord::setLiveOutput(bool liveOutput)
+{
+    m_liveOutput = liveOutput;
+}
+
 static QStringList sudoOptions(const QString& sudoBinary)
 {
     QStringList options;
@@ -177,31 +183,43 @@ void PerfRecord::startRecording(const QStringList& perfOptions, const QString& o
         m_perfRecordProcess->deleteLater();
     }
     m_perfRecordProcess = new QProcess(this);
-    m_perfRecordProcess->setProcessChannelMode(QProcess::MergedChannels);
 
-    QFileInfo outputFileInfo(outputPath);
-    QString folderPath = outputFileInfo.dir().path();
-    QFileInfo folderInfo(folderPath);
-    if (!folderInfo.exists()) {
-        emit recordingFailed(tr("Folder '%1' does not exist.").arg(folderPath));
-        return;
-    }
-    if (!folderInfo.isDir()) {
-        emit recordingFailed(tr("'%1' is not a folder.").arg(folderPath));
-        return;
-    }
-    if (!folderInfo.isWritable()) {
-        emit recordingFailed(tr("Folder '%1' is not writable.").arg(folderPath));
-        return;
+    const bool isLive = m_liveOutput;
+    if (isLive) {
+        // perf writes the data to stdout, keep its messages apart from that
+        m_perfRecordProcess->setProcessChannelMode(QProcess::SeparateChannels);
+        connect(m_perfRecordProcess.data(), &QProcess::readyReadStandardOutput, this,
+                [this]() { emit recordingData(m_perfRecordProcess->readAllStandardOutput()); });
+    } else {
+        m_perfRecordProcess->setProcessChannelMode(QProcess::MergedChannels);
+
+        QFileInfo outputFileInfo(outputPath);
+        QString folderPath = outputFileInfo.dir().path();
+        QFileInfo folderInfo(folderPath);
+        if (!folderInfo.exists()) {
+            emit recordingFailed(tr("Folder '%1' does not exist.").arg(folderPath));
+            return;
+        }
+        if (!folderInfo.isDir()) {
+            emit recordingFailed(tr("'%1' is not a folder.").arg(folderPath));
+            return;
+        }
+        if (!folderInfo.isWritable()) {
+            emit recordingFailed(tr("Folder '%1' is not writable.").arg(folderPath));
+            return;
+        }
     }
 
     connect(m_perfRecordProcess.data(), static_cast<void (QProcess::*)(int, QProcess::ExitStatus)>(&QProcess::finished),
-            this, [this](int exitCode, QProcess::ExitStatus exitStatus) {
+            this, [this, isLive](int exitCode, QProcess::ExitStatus exitStatus) {
                 Q_UNUSED(exitStatus)
 
                 QFileInfo outputFileInfo(m_outputPath);
-                if ((exitCode == EXIT_SUCCESS || (exitCode == SIGTERM && m_userTerminated) || outputFileInfo.size() > 0)
-                    && outputFileInfo.exists()) {
+                if (isLive && (exitCode == EXIT_SUCCESS || m_userTerminated)) {
+                    emit recordingFinished(m_outputPath);
+                } else if ((exitCode == EXIT_SUCCESS || (exitCode == SIGTERM && m_userTerminated)
+                            || outputFileInfo.size() > 0)
+                           && outputFileInfo.exists()) {
                     emit recordingFinished(m_outputPath);
                 } else {
                     emit recordingFailed(tr("Failed to record perf data, error code %1.").arg(exitCode));
@@ -216,10 +234,17 @@ void PerfRecord::startRecording(const QStringList& perfOptions, const QString& o
         }
     });
 
-    connect(m_perfRecordProcess.data(), &QProcess::readyRead, this, [this]() {
-        QString output = QString::fromUtf8(m_perfRecordProcess->readAll());
-        emit recordingOutput(output);
-    });
+    if (isLive) {
+        connect(m_perfRecordProcess.data(), &QProcess::readyReadStandardError, this, [this]() {
+            QString output = QString::fromUtf8(m_perfRecordProcess->readAllStandardError());
+            emit recordingOutput(output);
+        });
+    } else {
+        connect(m_perfRecordProcess.data(), &QProcess::readyRead, this, [this]() {
+            QString output = QString::fromUtf8(m_perfRecordProcess->readAll());
+            emit recordingOutput(output);
+        });
+    }
 
     m_outputPath = outputPath;
     auto perfBinary = QStringLiteral("perf");
@@ -228,7 +253,8 @@ void PerfRecord::startRecording(const QStringList& perfOptions, const QString& o
         m_perfRecordProcess->setWorkingDirectory(workingDirectory);
     }
 
-    QStringList perfCommand = {QStringLiteral("record"), QStringLiteral("-o"), m_outputPath};
+    QStringList perfCommand = {QStringLiteral("record"), QStringLiteral("-o"),
+                               isLive ? QStringLiteral("-") : m_outputPath};
     perfCommand += perfOptions;
     perfCommand += recordOptions;
 
@@ -272,7 +298,13 @@ void PerfRecord::record(const QStringList& perfOptions, const QString& outputPat
         return;
     }
 
-    QStringList recordOptions = {exeFileInfo.absoluteFilePath()};
+    QStringList recordOptions;
+    if (m_liveOutput) {
+        // perf writes the data to stdout which the application inherits, redirect its output to stderr
+        recordOptions = QStringList{QStringLiteral("sh"), QStringLiteral("-c"), QStringLiteral("exec \"$@\" >&2"),
+                                    QStringLiteral("sh")};
+    }
+    recordOptions += exeFileInfo.absoluteFilePath();
     recordOptions += exeOptions;
 
     startRecording(elevatePrivileges, perfOptions, outputPath, recordOptions, workingDirectory);
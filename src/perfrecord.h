@@ -39,6 +39,9 @@ public:
     explicit PerfRecord(QObject* parent = nullptr);
     ~PerfRecord();
 
+    // when enabled, the data gets streamed via recordingData instead of being written to the output path
+    void setLiveOutput(bool liveOutput);
+
     void record(const QStringList& perfOptions, const QString& outputPath, bool elevatePrivileges,
                 const QString& exePath, const QStringList& exeOptions, const QString& workingDirectory = QString());
     void record(const QStringList& perfOptions, const QString& outputPath, bool elevatePrivileges,
@@ -68,12 +71,15 @@ signals:
     void recordingFinished(const QString& fileLocation);
     void recordingFailed(const QString& errorMessage);
     void recordingOutput(const QString& errorMessage);
+    // the perf data in pipe mode, only emitted when the live output is enabled
+    void recordingData(const QByteArray& data);
 
 private:
     QPointer<QProcess> m_perfRecordProcess;
     QPointer<QProcess> m_elevatePrivilegesProcess;
     QString m_outputPath;
     bool m_userTerminated;
+    bool m_liveOutput;
 
     void startRecording(bool elevatePrivileges, const QStringList& perfOptions, const QString& outputPath,
                         const QStringList& recordOptions, const QString& workingDirectory = QString());
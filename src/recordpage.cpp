@@ -272,14 +272,24 @@ RecordPage::RecordPage(QWidget* parent)
                 appendOutput(QLatin1String("$ ") + perfBinary + QLatin1Char(' ') + arguments.join(QLatin1Char(' '))
                              + QLatin1Char('\n'));
                 ui->perfInputEdit->setEnabled(true);
+                if (m_isLiveRecording) {
+                    emit liveRecordingStarted();
+                }
             });
 
+    connect(m_perfRecord, &PerfRecord::recordingData, this, &RecordPage::liveRecordingData);
+
     connect(m_perfRecord, &PerfRecord::recordingFinished, this, [this](const QString& fileLocation) {
         appendOutput(tr("\nrecording finished after %1").arg(Util::formatTimeString(m_recordTimer.nsecsElapsed())));
-        m_resultsFile = fileLocation;
         setError({});
         recordingStopped();
-        ui->viewPerfRecordResultsButton->setEnabled(true);
+        if (m_isLiveRecording) {
+            // the results got analyzed already, there is no file to view
+            emit liveRecordingFinished();
+        } else {
+            m_resultsFile = fileLocation;
+            ui->viewPerfRecordResultsButton->setEnabled(true);
+        }
     });
 
     connect(m_perfRecord, &PerfRecord::recordingFailed, this, [this](const QString& errorMessage) {
@@ -292,6 +302,10 @@ RecordPage::RecordPage(QWidget* parent)
         setError(errorMessage);
         recordingStopped();
         ui->viewPerfRecordResultsButton->setEnabled(false);
+        if (m_isLiveRecording) {
+            // let the parser finish with whatever got recorded
+            emit liveRecordingFinished();
+        }
     });
 
     connect(m_perfRecord, &PerfRecord::recordingOutput, this, &RecordPage::appendOutput);
@@ -343,6 +357,10 @@ RecordPage::RecordPage(QWidget* parent)
     ui->mmapPagesSpinBox->setValue(config().readEntry(QStringLiteral("mmapPages"), 0));
     ui->mmapPagesUnitComboBox->setCurrentIndex(config().readEntry(QStringLiteral("mmapPagesUnit"), 2));
     ui->useAioCheckBox->setChecked(config().readEntry(QStringLiteral("useAio"), PerfRecord::canUseAio()));
+    // the output file isn't used when analyzing live
+    connect(ui->liveAnalysisCheckBox, &QCheckBox::toggled, ui->outputFile,
+            [this](bool checked) { ui->outputFile->setEnabled(!checked); });
+    ui->liveAnalysisCheckBox->setChecked(config().readEntry(QStringLiteral("liveAnalysis"), false));
 
     const auto callGraph = config().readEntry("callGraph", ui->callGraphComboBox->currentData());
     const auto callGraphIdx = ui->callGraphComboBox->findData(callGraph);
@@ -467,8 +485,12 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
         }
         config().writeEntry(QStringLiteral("useAio"), useAioEnabled);
 
+        m_isLiveRecording = ui->liveAnalysisCheckBox->isChecked();
+        config().writeEntry(QStringLiteral("liveAnalysis"), m_isLiveRecording);
+
         const auto compressionLevel = ui->compressionComboBox->currentData().toInt();
-        if (PerfRecord::canCompress() && compressionLevel >= 0) {
+        // perf doesn't compress in pipe mode
+        if (PerfRecord::canCompress() && compressionLevel >= 0 && !m_isLiveRecording) {
             if (compressionLevel == 0)
                 perfOptions += QStringLiteral("-z");
             else
@@ -518,6 +540,7 @@ void RecordPage::onStartRecordingButtonClicked(bool checked)
         config().writeEntry(QStringLiteral("mmapPages"), mmapPages);
         config().writeEntry(QStringLiteral("mmapPagesUnit"), mmapPagesUnit);
 
+        m_perfRecord->setLiveOutput(m_isLiveRecording);
         const auto outputFile = ui->outputFile->url().toLocalFile();
 
         switch (recordType) {
@@ -65,6 +65,10 @@ public:
 signals:
     void homeButtonClicked();
     void openFile(QString filePath);
+    // emitted instead of openFile when the live analysis is enabled, the data is the output of `perf record -o -`
+    void liveRecordingStarted();
+    void liveRecordingData(const QByteArray& data);
+    void liveRecordingFinished();
 
 private slots:
     void onApplicationNameChanged(const QString& filePath);
@@ -89,6 +93,7 @@ private:
 
     PerfRecord* m_perfRecord;
     QString m_resultsFile;
+    bool m_isLiveRecording = false;
     QElapsedTimer m_recordTimer;
     QTimer* m_updateRuntimeTimer;
 
@@ -90,16 +90,27 @@ ResultsBottomUpPage::ResultsBottomUpPage(FilterAndZoomStack* filterStack, PerfPa
     topHotspotsProxy->setSourceModel(bottomUpCostModel);
 
     connect(parser, &PerfParser::bottomUpDataAvailable, this,
-            [this, bottomUpCostModel, exportMenu](const Data::BottomUpResults& data) {
+            [this, bottomUpCostModel, exportMenu](const Data::Snapshot<Data::BottomUpResults>& data) {
                 bottomUpCostModel->setData(data);
-                ResultsUtil::hideEmptyColumns(data.costs, ui->bottomUpTreeView, BottomUpModel::NUM_BASE_COLUMNS);
-
-                {
-                    auto stackCollapsed = exportMenu->addMenu(QIcon::fromTheme(QStringLiteral("text-plain")), tr("Stack Collapsed"));
-                    stackCollapsed->setToolTip(tr("Export data in textual form compatible with <tt>flamegraph.pl</tt>."));
-                    for (int i = 0; i < data.costs.numTypes(); ++i) {
-                        const auto costName = data.costs.typeName(i);
-                        stackCollapsed->addAction(costName, [this, i, bottomUpCostModel, costName]() {
+                ResultsUtil::hideEmptyColumns(data->costs, ui->bottomUpTreeView, BottomUpModel::NUM_BASE_COLUMNS);
+
+                if (!m_stackCollapsedMenu) {
+                    m_stackCollapsedMenu =
+                        exportMenu->addMenu(QIcon::fromTheme(QStringLiteral("text-plain")), tr("Stack Collapsed"));
+                    m_stackCollapsedMenu->setToolTip(
+                        tr("Export data in textual form compatible with <tt>flamegraph.pl</tt>."));
+                }
+
+                // we get new data for partial results and every filter, but the actions only depend on the cost types
+                QStringList costNames;
+                for (int i = 0; i < data->costs.numTypes(); ++i)
+                    costNames.append(data->costs.typeName(i));
+                if (costNames != m_stackCollapsedCostNames) {
+                    m_stackCollapsedCostNames = costNames;
+                    m_stackCollapsedMenu->clear();
+                    for (int i = 0; i < costNames.size(); ++i) {
+                        const auto costName = costNames.at(i);
+                        m_stackCollapsedMenu->addAction(costName, [this, i, bottomUpCostModel, costName]() {
                             const auto fileName = QFileDialog::getSaveFileName(this, tr("Export %1 Data").arg(costName));
                             if (fileName.isEmpty())
                                 return;
@@ -121,4 +132,7 @@ ResultsBottomUpPage::~ResultsBottomUpPage() = default;
 void ResultsBottomUpPage::clear()
 {
     ui->bottomUpSearch->setText({});
+    delete m_stackCollapsedMenu;
+    m_stackCollapsedMenu = nullptr;
+    m_stackCollapsedCostNames.clear();
 }
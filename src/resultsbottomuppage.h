@@ -27,6 +27,7 @@
 
 #pragma once
 
+#include <QStringList>
 #include <QWidget>
 
 class QMenu;
@@ -60,4 +61,7 @@ signals:
 
 private:
     QScopedPointer<Ui::ResultsBottomUpPage> ui;
+    QMenu* m_stackCollapsedMenu = nullptr;
+    // the cost types the actions of m_stackCollapsedMenu were created for
+    QStringList m_stackCollapsedCostNames;
 };
@@ -88,19 +88,21 @@ ResultsCallerCalleePage::ResultsCallerCalleePage(FilterAndZoomStack* filterStack
     ResultsUtil::setupHeaderView(ui->callerCalleeTableView);
     ResultsUtil::setupCostDelegate(m_callerCalleeCostModel, ui->callerCalleeTableView);
 
-    connect(parser, &PerfParser::callerCalleeDataAvailable, this, [this](const Data::CallerCalleeResults& data) {
-        m_callerCalleeCostModel->setResults(data);
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callerCalleeTableView,
-                                      CallerCalleeModel::NUM_BASE_COLUMNS);
-        ResultsUtil::hideEmptyColumns(data.selfCosts, ui->callerCalleeTableView,
-                                      CallerCalleeModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
-        auto view = ui->callerCalleeTableView;
-        view->sortByColumn(CallerCalleeModel::InitialSortColumn, view->header()->sortIndicatorOrder());
-        view->setCurrentIndex(view->model()->index(0, 0, {}));
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->callersView, CallerModel::NUM_BASE_COLUMNS);
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->calleesView, CalleeModel::NUM_BASE_COLUMNS);
-        ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->sourceMapView, SourceMapModel::NUM_BASE_COLUMNS);
-    });
+    connect(parser, &PerfParser::callerCalleeDataAvailable, this,
+            [this](const Data::Snapshot<Data::CallerCalleeResults>& data) {
+                m_callerCalleeCostModel->setResults(data);
+                ResultsUtil::hideEmptyColumns(data->inclusiveCosts, ui->callerCalleeTableView,
+                                              CallerCalleeModel::NUM_BASE_COLUMNS);
+                ResultsUtil::hideEmptyColumns(data->selfCosts, ui->callerCalleeTableView,
+                                              CallerCalleeModel::NUM_BASE_COLUMNS + data->inclusiveCosts.numTypes());
+                auto view = ui->callerCalleeTableView;
+                view->sortByColumn(CallerCalleeModel::InitialSortColumn, view->header()->sortIndicatorOrder());
+                view->setCurrentIndex(view->model()->index(0, 0, {}));
+                ResultsUtil::hideEmptyColumns(data->inclusiveCosts, ui->callersView, CallerModel::NUM_BASE_COLUMNS);
+                ResultsUtil::hideEmptyColumns(data->inclusiveCosts, ui->calleesView, CalleeModel::NUM_BASE_COLUMNS);
+                ResultsUtil::hideEmptyColumns(data->inclusiveCosts, ui->sourceMapView,
+                                              SourceMapModel::NUM_BASE_COLUMNS);
+            });
 
     auto calleesModel = setupModelAndProxyForView<CalleeModel>(ui->calleesView);
     auto callersModel = setupModelAndProxyForView<CallerModel>(ui->callersView);
@@ -249,6 +251,6 @@ void ResultsCallerCalleePage::openEditor(const Data::Symbol& symbol)
 
     if (it == map.keyEnd()) {
         emit navigateToCodeFailed(
-            tr("Failed to find location for symbol %1 in %2.").arg(symbol.prettySymbol, symbol.binary));
+            tr("Failed to find location for symbol %1 in %2.").arg(symbol.prettySymbol(), symbol.binary));
     }
 }
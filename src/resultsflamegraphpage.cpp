@@ -59,8 +59,12 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
     ui->flameGraph->setFilterStack(filterStack);
 
     connect(parser, &PerfParser::bottomUpDataAvailable, this,
-            [this, exportMenu](const Data::BottomUpResults& data) {
+            [this, exportMenu](const Data::Snapshot<Data::BottomUpResults>& data) {
                 ui->flameGraph->setBottomUpData(data);
+                // we get new data for partial results and every filter, but only need a single export action
+                if (m_exportAction) {
+                    return;
+                }
                 m_exportAction = exportMenu->addAction(QIcon::fromTheme(QStringLiteral("image-x-generic")), tr("Flamegraph"));
                 connect(m_exportAction, &QAction::triggered, this, [this]() {
                     const auto filter = tr("Images (%1);;SVG (*.svg)").arg(imageFormatFilter());
@@ -81,7 +85,7 @@ ResultsFlameGraphPage::ResultsFlameGraphPage(FilterAndZoomStack* filterStack, Pe
             });
 
     connect(parser, &PerfParser::topDownDataAvailable, this,
-            [this](const Data::TopDownResults& data) { ui->flameGraph->setTopDownData(data); });
+            [this](const Data::Snapshot<Data::TopDownResults>& data) { ui->flameGraph->setTopDownData(data); });
 
     connect(ui->flameGraph, &FlameGraph::jumpToCallerCallee, this, &ResultsFlameGraphPage::jumpToCallerCallee);
     connect(ui->flameGraph, &FlameGraph::openEditor, this, &ResultsFlameGraphPage::openEditor);
@@ -122,23 +122,25 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
     connect(timeLineProxy, &QAbstractItemModel::rowsInserted, this, [this]() { ui->timeLineView->expandToDepth(1); });
     connect(timeLineProxy, &QAbstractItemModel::modelReset, this, [this]() { ui->timeLineView->expandToDepth(1); });
 
-    connect(parser, &PerfParser::bottomUpDataAvailable, this, [this](const Data::BottomUpResults& data) {
-        ResultsUtil::fillEventSourceComboBox(ui->timeLineEventSource, data.costs,
-                                             ki18n("Show timeline for %1 events."));
-    });
-    connect(parser, &PerfParser::eventsAvailable, this, [this, eventModel](const Data::EventResults& data) {
-        eventModel->setData(data);
-        m_timeAxisHeaderView->setTimeRange(eventModel->timeRange());
-        if (data.offCpuTimeCostId != -1) {
-            // remove the off-CPU time event source, we only want normal sched switches
-            for (int i = 0, c = ui->timeLineEventSource->count(); i < c; ++i) {
-                if (ui->timeLineEventSource->itemData(i).toInt() == data.offCpuTimeCostId) {
-                    ui->timeLineEventSource->removeItem(i);
-                    break;
+    connect(parser, &PerfParser::bottomUpDataAvailable, this,
+            [this](const Data::Snapshot<Data::BottomUpResults>& data) {
+                ResultsUtil::fillEventSourceComboBox(ui->timeLineEventSource, data->costs,
+                                                     ki18n("Show timeline for %1 events."));
+            });
+    connect(parser, &PerfParser::eventsAvailable, this,
+            [this, eventModel](const Data::Snapshot<Data::EventResults>& data) {
+                eventModel->setData(data);
+                m_timeAxisHeaderView->setTimeRange(eventModel->timeRange());
+                if (data->offCpuTimeCostId != -1) {
+                    // remove the off-CPU time event source, we only want normal sched switches
+                    for (int i = 0, c = ui->timeLineEventSource->count(); i < c; ++i) {
+                        if (ui->timeLineEventSource->itemData(i).toInt() == data->offCpuTimeCostId) {
+                            ui->timeLineEventSource->removeItem(i);
+                            break;
+                        }
+                    }
                 }
-            }
-        }
-    });
+            });
     connect(m_filterAndZoomStack, &FilterAndZoomStack::filterChanged, parser, &PerfParser::filterResults);
 
     connect(ui->timeLineEventSource, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this,
@@ -157,6 +159,10 @@ ResultsPage::ResultsPage(PerfParser* parser, QWidget* parent)
         repositionFilterBusyIndicator();
         m_filterBusyIndicator->setVisible(true);
     });
+    connect(parser, &PerfParser::partialResultsAvailable, this, [this]() {
+        // show the partial timeline of live results, but keep it disabled as we can't filter yet
+        m_filterBusyIndicator->setVisible(false);
+    });
     connect(parser, &PerfParser::parsingFinished, this, [this]() {
         // re-enable when we finished filtering
         ui->timeLineArea->setEnabled(true);
@@ -72,10 +72,10 @@ ResultsSummaryPage::ResultsSummaryPage(FilterAndZoomStack* filterStack, PerfPars
             });
 
     connect(parser, &PerfParser::bottomUpDataAvailable, this,
-            [this, bottomUpCostModel](const Data::BottomUpResults& data) {
+            [this, bottomUpCostModel](const Data::Snapshot<Data::BottomUpResults>& data) {
                 bottomUpCostModel->setData(data);
-                ResultsUtil::hideEmptyColumns(data.costs, ui->topHotspotsTableView, BottomUpModel::NUM_BASE_COLUMNS);
-                ResultsUtil::fillEventSourceComboBox(ui->eventSourceComboBox, data.costs,
+                ResultsUtil::hideEmptyColumns(data->costs, ui->topHotspotsTableView, BottomUpModel::NUM_BASE_COLUMNS);
+                ResultsUtil::fillEventSourceComboBox(ui->eventSourceComboBox, data->costs,
                                                      ki18n("Show top hotspots for %1 events."));
             });
 
@@ -46,11 +46,11 @@ ResultsTopDownPage::ResultsTopDownPage(FilterAndZoomStack* filterStack, PerfPars
     ResultsUtil::setupContextMenu(ui->topDownTreeView, topDownCostModel, filterStack, this);
 
     connect(parser, &PerfParser::topDownDataAvailable, this,
-            [this, topDownCostModel](const Data::TopDownResults& data) {
+            [this, topDownCostModel](const Data::Snapshot<Data::TopDownResults>& data) {
                 topDownCostModel->setData(data);
-                ResultsUtil::hideEmptyColumns(data.inclusiveCosts, ui->topDownTreeView, TopDownModel::NUM_BASE_COLUMNS);
-                ResultsUtil::hideEmptyColumns(data.selfCosts, ui->topDownTreeView,
-                                              TopDownModel::NUM_BASE_COLUMNS + data.inclusiveCosts.numTypes());
+                ResultsUtil::hideEmptyColumns(data->inclusiveCosts, ui->topDownTreeView, TopDownModel::NUM_BASE_COLUMNS);
+                ResultsUtil::hideEmptyColumns(data->selfCosts, ui->topDownTreeView,
+                                              TopDownModel::NUM_BASE_COLUMNS + data->inclusiveCosts.numTypes());
             });
 }
 
@@ -60,7 +60,7 @@ QString Util::formatString(const QString& input, bool replaceEmptyString)
 
 QString Util::formatSymbol(const Data::Symbol& symbol, bool replaceEmptyString)
 {
-    return formatString(Settings::instance()->prettifySymbols() ? symbol.prettySymbol : symbol.symbol,
+    return formatString(Settings::instance()->prettifySymbols() ? symbol.prettySymbol() : symbol.symbol,
                         replaceEmptyString);
 }
 
@@ -0,0 +1,120 @@
+/*
+  bench_perfparser.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTest>
+
+#include "data.h"
+#include "perfparser.h"
+#include "perfstreamwriter.h"
+
+class BenchPerfParser : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        // replay the generated streams instead of parsing perf.data files
+        const auto replayBinary = QCoreApplication::applicationDirPath() + QLatin1String("/replay_perfparser");
+        if (!QFileInfo(replayBinary).isExecutable()) {
+            QSKIP("replay_perfparser is not available, cannot run the benchmarks.");
+        }
+        qputenv("HOTSPOT_PERFPARSER", replayBinary.toLocal8Bit());
+
+        qRegisterMetaType<Data::Summary>();
+        qRegisterMetaType<Data::Snapshot<Data::BottomUpResults>>("Data::Snapshot<Data::BottomUpResults>");
+        qRegisterMetaType<Data::Snapshot<Data::TopDownResults>>("Data::Snapshot<Data::TopDownResults>");
+        qRegisterMetaType<Data::Snapshot<Data::CallerCalleeResults>>("Data::Snapshot<Data::CallerCalleeResults>");
+        qRegisterMetaType<Data::Snapshot<Data::EventResults>>("Data::Snapshot<Data::EventResults>");
+    }
+
+    void benchManyThreads_data()
+    {
+        QTest::addColumn<int>("numThreads");
+        QTest::newRow("12500") << 12500;
+        QTest::newRow("25000") << 25000;
+        QTest::newRow("50000") << 50000;
+    }
+
+    void benchManyThreads()
+    {
+        // a stream of short-lived threads, each of which gets started, named, sampled a few times and ended.
+        // the tids get reused regularly, the time spent should thus grow linearly with the number of threads
+        QFETCH(int, numThreads);
+        const int numProcesses = 100;
+        const int numTids = numThreads / 4;
+        const int numSamples = 10;
+
+        QTemporaryFile streamFile;
+        QVERIFY(streamFile.open());
+        {
+            StreamWriter writer(&streamFile);
+            writer.string(0, "cycles");
+            writer.string(1, "bench_thread");
+            writer.string(2, "bench_func()");
+            writer.string(3, "libbench.so");
+            writer.string(4, "/usr/lib/libbench.so");
+            writer.attributes(0, 0, 1000);
+            writer.location(0, 0x1000);
+            writer.symbol(0, 2, 3, 4);
+
+            for (int i = 0; i < numThreads; ++i) {
+                const quint32 tid = 100000 + i % numTids;
+                const quint32 pid = 1000 + tid % numProcesses;
+                const quint64 start = quint64(i) * 100;
+                writer.threadStart(pid, tid, start);
+                writer.command(pid, tid, start, 1);
+                for (int j = 0; j < numSamples; ++j) {
+                    writer.sample(pid, tid, start + j + 1, 0, 0, 1000);
+                }
+                writer.threadEnd(pid, tid, start + numSamples + 1);
+            }
+        }
+        QVERIFY(streamFile.flush());
+
+        QBENCHMARK {
+            PerfParser parser;
+            QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+            QSignalSpy parsingFailedSpy(&parser, &PerfParser::parsingFailed);
+            QSignalSpy eventsSpy(&parser, &PerfParser::eventsAvailable);
+            parser.startParseFile(streamFile.fileName(), {}, {}, {}, {}, {}, {});
+            QVERIFY(parsingFinishedSpy.wait(600000));
+            QCOMPARE(parsingFailedSpy.count(), 0);
+
+            const auto events = eventsSpy.last().first().value<Data::Snapshot<Data::EventResults>>();
+            QCOMPARE(events->threads.size(), numThreads);
+            QCOMPARE(events->threads.last().events.size(), numSamples);
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(BenchPerfParser);
+
+#include "bench_perfparser.moc"
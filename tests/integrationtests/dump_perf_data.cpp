@@ -27,10 +27,13 @@
 
 #include <QCoreApplication>
 #include <QDebug>
+#include <QElapsedTimer>
 
 #include "../testutils.h"
 #include "perfparser.h"
 
+#include <memory>
+
 int main(int argc, char** argv)
 {
     QCoreApplication app(argc, argv);
@@ -46,10 +49,17 @@ int main(int argc, char** argv)
     qRegisterMetaType<Data::EventResults>();
     qRegisterMetaType<Data::Summary>();
     qRegisterMetaType<Data::CallerCalleeResults>();
+    qRegisterMetaType<Data::Snapshot<Data::BottomUpResults>>("Data::Snapshot<Data::BottomUpResults>");
+    qRegisterMetaType<Data::Snapshot<Data::TopDownResults>>("Data::Snapshot<Data::TopDownResults>");
+    qRegisterMetaType<Data::Snapshot<Data::CallerCalleeResults>>("Data::Snapshot<Data::CallerCalleeResults>");
+    qRegisterMetaType<Data::Snapshot<Data::EventResults>>("Data::Snapshot<Data::EventResults>");
 
     int runningParsers = 0;
     for (const auto& arg : args) {
         auto parser = new PerfParser(&app);
+        // shared with the lambdas below, allows to compare the parse throughput across versions
+        auto timer = std::make_shared<QElapsedTimer>();
+        timer->start();
         parser->startParseFile(arg, {}, {}, {}, {}, {}, {});
         ++runningParsers;
         QObject::connect(parser, &PerfParser::parsingFinished, parser, [&runningParsers, &app]() {
@@ -63,12 +73,14 @@ int main(int argc, char** argv)
             if (!runningParsers)
                 app.quit();
         });
-        QObject::connect(parser, &PerfParser::bottomUpDataAvailable, parser, [arg](const Data::BottomUpResults& data) {
+        QObject::connect(parser, &PerfParser::bottomUpDataAvailable, parser, [arg](const Data::Snapshot<Data::BottomUpResults>& data) {
             qDebug() << arg;
-            dumpList(printTree(data));
+            dumpList(printTree(*data));
         });
-        QObject::connect(parser, &PerfParser::summaryDataAvailable, parser, [arg](const Data::Summary& data) {
+        QObject::connect(parser, &PerfParser::summaryDataAvailable, parser, [arg, timer](const Data::Summary& data) {
+            const auto elapsed = std::max(timer->elapsed(), qint64(1));
             qDebug() << "summary for" << arg;
+            qDebug() << "parse time:" << elapsed << "ms," << (data.sampleCount * 1000 / elapsed) << "samples/s";
             qDebug() << "runtime:" << Util::formatTimeString(data.applicationRunningTime);
             qDebug() << "on-CPU:" << Util::formatTimeString(data.onCpuTime);
             qDebug() << "off-CPU:" << Util::formatTimeString(data.offCpuTime);
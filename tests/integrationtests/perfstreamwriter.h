@@ -0,0 +1,158 @@
+/*
+  perfstreamwriter.h
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <QDataStream>
+#include <QIODevice>
+#include <QtEndian>
+
+/**
+ * Writes the stream that hotspot-perfparser sends to hotspot, i.e. the "QPERFSTREAM" magic and the data stream
+ * version, followed by the events, each prefixed with its size. Only the events needed by the tests and benchmarks
+ * are supported, their layout has to match the one decoded in perfparser.cpp.
+ */
+class StreamWriter
+{
+public:
+    enum class EventType : qint8
+    {
+        ThreadStart,
+        ThreadEnd,
+        Command,
+        LocationDefinition,
+        SymbolDefinition,
+        StringDefinition,
+        AttributesDefinition = 11,
+        ContextSwitchDefinition = 12,
+        Sample = 13
+    };
+
+    explicit StreamWriter(QIODevice* device)
+        : m_device(device)
+    {
+        // including the trailing \0
+        m_device->write("QPERFSTREAM", sizeof("QPERFSTREAM"));
+        const auto version = qToLittleEndian<qint32>(DATA_STREAM_VERSION);
+        m_device->write(reinterpret_cast<const char*>(&version), sizeof(version));
+    }
+
+    void string(qint32 id, const QByteArray& string)
+    {
+        write(EventType::StringDefinition, [&](QDataStream& stream) { stream << id << string; });
+    }
+
+    void attributes(qint32 id, qint32 nameId, quint64 period)
+    {
+        write(EventType::AttributesDefinition, [&](QDataStream& stream) {
+            // type, config, name, usesFrequency, frequencyOrPeriod
+            stream << id << quint32(0) << quint64(0) << nameId << false << period;
+        });
+    }
+
+    void location(qint32 id, quint64 address)
+    {
+        write(EventType::LocationDefinition, [&](QDataStream& stream) {
+            // address, file, pid, line, column, parentLocationId
+            stream << id << address << qint32(-1) << quint32(0) << qint32(-1) << qint32(-1) << qint32(-1);
+        });
+    }
+
+    void symbol(qint32 id, qint32 nameId, qint32 binaryId, qint32 pathId)
+    {
+        write(EventType::SymbolDefinition,
+              [&](QDataStream& stream) { stream << id << nameId << binaryId << pathId << false; });
+    }
+
+    void threadStart(quint32 pid, quint32 tid, quint64 time)
+    {
+        write(EventType::ThreadStart, [&](QDataStream& stream) {
+            record(stream, pid, tid, time);
+            // ppid
+            stream << pid;
+        });
+    }
+
+    void command(quint32 pid, quint32 tid, quint64 time, qint32 commId)
+    {
+        write(EventType::Command, [&](QDataStream& stream) {
+            record(stream, pid, tid, time);
+            stream << commId;
+        });
+    }
+
+    void sample(quint32 pid, quint32 tid, quint64 time, qint32 locationId, qint32 attributeId, quint64 cost)
+    {
+        write(EventType::Sample, [&](QDataStream& stream) {
+            record(stream, pid, tid, time);
+            // one frame, no guessed frames and one cost
+            stream << quint32(1) << locationId << quint8(0) << quint32(1) << attributeId << cost;
+        });
+    }
+
+    void contextSwitch(quint32 pid, quint32 tid, quint64 time, quint32 cpu, bool switchOut)
+    {
+        write(EventType::ContextSwitchDefinition, [&](QDataStream& stream) {
+            record(stream, pid, tid, time, cpu);
+            stream << switchOut;
+        });
+    }
+
+    void threadEnd(quint32 pid, quint32 tid, quint64 time)
+    {
+        write(EventType::ThreadEnd, [&](QDataStream& stream) { record(stream, pid, tid, time); });
+    }
+
+private:
+    static const qint32 DATA_STREAM_VERSION = QDataStream::Qt_DefaultCompiledVersion;
+
+    static void record(QDataStream& stream, quint32 pid, quint32 tid, quint64 time, quint32 cpu)
+    {
+        stream << pid << tid << time << cpu;
+    }
+
+    static void record(QDataStream& stream, quint32 pid, quint32 tid, quint64 time)
+    {
+        record(stream, pid, tid, time, tid % 8);
+    }
+
+    template<typename Payload>
+    void write(EventType type, Payload payload)
+    {
+        m_buffer.clear();
+        QDataStream stream(&m_buffer, QIODevice::WriteOnly);
+        stream.setVersion(DATA_STREAM_VERSION);
+        stream << static_cast<qint8>(type);
+        payload(stream);
+
+        const auto size = qToLittleEndian<quint32>(m_buffer.size());
+        m_device->write(reinterpret_cast<const char*>(&size), sizeof(size));
+        m_device->write(m_buffer);
+    }
+
+    QIODevice* m_device;
+    QByteArray m_buffer;
+};
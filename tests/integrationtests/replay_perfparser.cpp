@@ -0,0 +1,69 @@
+/*
+  replay_perfparser.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QFile>
+
+// stands in for hotspot-perfparser when HOTSPOT_PERFPARSER points to it: instead of parsing a perf.data file,
+// the already parsed stream that got passed via --input is written to stdout as is. this allows to measure
+// hotspot's side of the parsing with synthetic data, see bench_perfparser
+int main(int argc, char** argv)
+{
+    QCoreApplication app(argc, argv);
+
+    // same as the exit codes of hotspot-perfparser
+    enum ErrorCodes
+    {
+        NoError,
+        TcpSocketError,
+        CannotOpen,
+        BadMagic,
+        HeaderError,
+        DataError,
+        MissingData,
+        InvalidOption
+    };
+
+    const auto args = app.arguments();
+    const auto inputIndex = args.indexOf(QStringLiteral("--input")) + 1;
+    if (inputIndex == 0 || inputIndex >= args.size()) {
+        qWarning("missing --input argument");
+        return InvalidOption;
+    }
+
+    QFile input(args[inputIndex]);
+    QFile output;
+    if (!input.open(QIODevice::ReadOnly) || !output.open(stdout, QIODevice::WriteOnly)) {
+        return CannotOpen;
+    }
+
+    while (!input.atEnd()) {
+        if (output.write(input.read(1024 * 1024)) == -1) {
+            return DataError;
+        }
+    }
+    return NoError;
+}
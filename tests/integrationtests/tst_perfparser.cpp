@@ -100,6 +100,10 @@ private slots:
         qRegisterMetaType<Data::TopDown>();
         qRegisterMetaType<Data::CallerCalleeEntryMap>("Data::CallerCalleeEntryMap");
         qRegisterMetaType<Data::EventResults>();
+        qRegisterMetaType<Data::Snapshot<Data::BottomUpResults>>("Data::Snapshot<Data::BottomUpResults>");
+        qRegisterMetaType<Data::Snapshot<Data::TopDownResults>>("Data::Snapshot<Data::TopDownResults>");
+        qRegisterMetaType<Data::Snapshot<Data::CallerCalleeResults>>("Data::Snapshot<Data::CallerCalleeResults>");
+        qRegisterMetaType<Data::Snapshot<Data::EventResults>>("Data::Snapshot<Data::EventResults>");
     }
 
     void init()
@@ -483,6 +487,107 @@ private slots:
         }
     }
 
+    void testPartialResults()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf", "--event", "cycles"};
+        const QStringList exeOptions = {"40"};
+
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-recursion/cpp-recursion";
+        QTemporaryFile tempFile;
+        tempFile.open();
+
+        perfRecord(perfOptions, exePath, exeOptions, tempFile.fileName());
+
+        PerfParser parser(this);
+        parser.setPartialResultsInterval(1);
+
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy partialResultsSpy(&parser, &PerfParser::partialResultsAvailable);
+        QSignalSpy summaryDataSpy(&parser, &PerfParser::summaryDataAvailable);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+        QSignalSpy topDownDataSpy(&parser, &PerfParser::topDownDataAvailable);
+        QSignalSpy callerCalleeDataSpy(&parser, &PerfParser::callerCalleeDataAvailable);
+
+        parser.startParseFile(tempFile.fileName(), "", "", "", "", "", "");
+        QVERIFY(parsingFinishedSpy.wait(6000));
+
+        // every partial result comes with all of its parts, the complete results are only emitted once
+        const int numResults = partialResultsSpy.count() + 1;
+        QCOMPARE(summaryDataSpy.count(), numResults);
+        QCOMPARE(bottomUpDataSpy.count(), numResults);
+        QCOMPARE(topDownDataSpy.count(), numResults);
+        QCOMPARE(callerCalleeDataSpy.count(), 1);
+
+        // partial results only ever grow, up to the complete results
+        quint64 lastSampleCount = 0;
+        qint64 lastTotalCost = 0;
+        for (int i = 0; i < numResults; ++i) {
+            const auto summary = summaryDataSpy.at(i).first().value<Data::Summary>();
+            const auto bottomUp = bottomUpDataSpy.at(i).first().value<Data::Snapshot<Data::BottomUpResults>>();
+            const auto topDown = topDownDataSpy.at(i).first().value<Data::Snapshot<Data::TopDownResults>>();
+            QVERIFY(summary.sampleCount >= lastSampleCount);
+            QVERIFY(bottomUp->costs.totalCost(0) >= lastTotalCost);
+            QCOMPARE(topDown->inclusiveCosts.totalCost(0), bottomUp->costs.totalCost(0));
+            validateCosts(bottomUp->costs, bottomUp->root);
+            lastSampleCount = summary.sampleCount;
+            lastTotalCost = bottomUp->costs.totalCost(0);
+        }
+    }
+
+    void testParseLive()
+    {
+        const QStringList perfOptions = {"--call-graph", "dwarf", "--event", "cycles"};
+        const QStringList exeOptions = {"40"};
+
+        const QString exePath = qApp->applicationDirPath() + "/../tests/test-clients/cpp-recursion/cpp-recursion";
+        QTemporaryFile tempFile;
+        tempFile.open();
+
+        perfRecord(perfOptions, exePath, exeOptions, tempFile.fileName());
+
+        // convert to the pipe mode data that `perf record -o -` writes while recording
+        QProcess inject;
+        inject.start("perf", {"inject", "-i", tempFile.fileName(), "-o", "-"});
+        QVERIFY(inject.waitForFinished(10000));
+        const auto data = inject.readAllStandardOutput();
+        QVERIFY(!data.isEmpty());
+
+        PerfParser parser(this);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy parsingFailedSpy(&parser, &PerfParser::parsingFailed);
+        QSignalSpy bottomUpDataSpy(&parser, &PerfParser::bottomUpDataAvailable);
+        QSignalSpy eventsDataSpy(&parser, &PerfParser::eventsAvailable);
+
+        const quint64 window = 10000000;
+        parser.startParseLive(window, "", "", "", "", "", "");
+        parser.addLiveData(data.left(data.size() / 2));
+        parser.addLiveData(data.mid(data.size() / 2));
+        parser.finishLiveData();
+
+        QVERIFY(parsingFinishedSpy.wait(6000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+
+        const auto bottomUp = bottomUpDataSpy.last().first().value<Data::Snapshot<Data::BottomUpResults>>();
+        QVERIFY(!bottomUp->root.children.isEmpty());
+        validateCosts(bottomUp->costs, bottomUp->root);
+
+        // the final aggregated data covers the whole recording, but the events only the last window
+        const auto events = eventsDataSpy.last().first().value<Data::Snapshot<Data::EventResults>>();
+        QVERIFY(!events->threads.isEmpty());
+        quint64 end = 0;
+        for (const auto& thread : events->threads) {
+            end = std::max(end, thread.time.end);
+        }
+        qint64 windowCost = 0;
+        for (const auto& thread : events->threads) {
+            for (const auto& event : thread.events) {
+                QVERIFY(event.time + window >= end);
+                windowCost += event.cost;
+            }
+        }
+        QVERIFY(windowCost <= bottomUp->costs.totalCost(0));
+    }
+
 private:
     Data::Summary m_summaryData;
     Data::BottomUpResults m_bottomUpData;
@@ -580,7 +685,7 @@ private:
         // Verify the top Bottom-Up symbol result contains the expected data
         COMPARE_OR_THROW(bottomUpDataSpy.count(), 1);
         QList<QVariant> bottomUpDataArgs = bottomUpDataSpy.takeFirst();
-        m_bottomUpData = bottomUpDataArgs.at(0).value<Data::BottomUpResults>();
+        m_bottomUpData = *bottomUpDataArgs.at(0).value<Data::Snapshot<Data::BottomUpResults>>();
         validateCosts(m_bottomUpData.costs, m_bottomUpData.root);
         VERIFY_OR_THROW(m_bottomUpData.root.children.count() > 0);
 
@@ -595,7 +700,7 @@ private:
         // Verify the top Top-Down symbol result contains the expected data
         COMPARE_OR_THROW(topDownDataSpy.count(), 1);
         QList<QVariant> topDownDataArgs = topDownDataSpy.takeFirst();
-        m_topDownData = topDownDataArgs.at(0).value<Data::TopDownResults>();
+        m_topDownData = *topDownDataArgs.at(0).value<Data::Snapshot<Data::TopDownResults>>();
         VERIFY_OR_THROW(m_topDownData.root.children.count() > 0);
 
         if (topTopDownSymbol.isValid()) {
@@ -612,7 +717,7 @@ private:
         // Verify the Caller/Callee data isn't empty
         COMPARE_OR_THROW(callerCalleeDataSpy.count(), 1);
         QList<QVariant> callerCalleeDataArgs = callerCalleeDataSpy.takeFirst();
-        m_callerCalleeData = callerCalleeDataArgs.at(0).value<Data::CallerCalleeResults>();
+        m_callerCalleeData = *callerCalleeDataArgs.at(0).value<Data::Snapshot<Data::CallerCalleeResults>>();
         VERIFY_OR_THROW(m_callerCalleeData.entries.count() > 0);
 
         // Verify that no individual cost in the Caller/Callee data is greater than the total cost of all samples
@@ -622,7 +727,7 @@ private:
 
         // Verify that the events data is not empty and somewhat sane
         COMPARE_OR_THROW(eventsDataSpy.count(), 1);
-        m_eventData = eventsDataSpy.first().first().value<Data::EventResults>();
+        m_eventData = *eventsDataSpy.first().first().value<Data::Snapshot<Data::EventResults>>();
         VERIFY_OR_THROW(!m_eventData.stacks.isEmpty());
         VERIFY_OR_THROW(!m_eventData.threads.isEmpty());
         COMPARE_OR_THROW(static_cast<quint32>(m_eventData.threads.size()), m_summaryData.threadCount);
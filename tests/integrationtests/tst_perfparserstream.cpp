@@ -0,0 +1,289 @@
+/*
+  tst_perfparserstream.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QCoreApplication>
+#include <QFileInfo>
+#include <QObject>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTest>
+
+#include <ThreadWeaver/ThreadWeaver>
+
+#include "data.h"
+#include "perfparser.h"
+#include "perfstreamwriter.h"
+
+namespace {
+// the definitions that every stream starts with: one cost type, one location and its symbol
+void writeDefinitions(StreamWriter* writer)
+{
+    writer->string(0, "cycles");
+    writer->string(1, "main");
+    writer->string(2, "libtest.so");
+    writer->string(3, "/usr/lib/libtest.so");
+    writer->attributes(0, 0, 1);
+    writer->location(0, 0x1000);
+    writer->symbol(0, 1, 2, 3);
+}
+
+qint64 totalCost(const QSignalSpy& bottomUpSpy)
+{
+    return bottomUpSpy.last().first().value<Data::Snapshot<Data::BottomUpResults>>()->costs.totalCost(0);
+}
+
+// waits for all filter jobs, including the results they publish on the main thread
+void waitForFilterJobs()
+{
+    ThreadWeaver::Queue::instance()->finish();
+    QCoreApplication::processEvents();
+}
+}
+
+/**
+ * Parses synthetic perfparser streams, which get replayed by replay_perfparser. Unlike tst_perfparser,
+ * this needs neither perf nor a recording, which allows to test specific sequences of events.
+ */
+class TestPerfParserStream : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        const auto replayBinary = QCoreApplication::applicationDirPath() + QLatin1String("/replay_perfparser");
+        if (!QFileInfo(replayBinary).isExecutable()) {
+            QSKIP("replay_perfparser is not available, cannot run the stream tests.");
+        }
+        qputenv("HOTSPOT_PERFPARSER", replayBinary.toLocal8Bit());
+
+        qRegisterMetaType<Data::Summary>();
+        qRegisterMetaType<Data::Snapshot<Data::BottomUpResults>>("Data::Snapshot<Data::BottomUpResults>");
+        qRegisterMetaType<Data::Snapshot<Data::TopDownResults>>("Data::Snapshot<Data::TopDownResults>");
+        qRegisterMetaType<Data::Snapshot<Data::CallerCalleeResults>>("Data::Snapshot<Data::CallerCalleeResults>");
+        qRegisterMetaType<Data::Snapshot<Data::EventResults>>("Data::Snapshot<Data::EventResults>");
+    }
+
+    void testSupersededFilter()
+    {
+        QTemporaryFile streamFile;
+        QVERIFY(streamFile.open());
+        {
+            StreamWriter writer(&streamFile);
+            writeDefinitions(&writer);
+            for (int i = 0; i < 3; ++i) {
+                writer.sample(1000, 1000, 10 + i, 0, 0, 10);
+            }
+            for (int i = 0; i < 5; ++i) {
+                writer.sample(2000, 2000, 20 + i, 0, 0, 20);
+            }
+        }
+        QVERIFY(streamFile.flush());
+
+        PerfParser parser;
+        parse(&parser, streamFile.fileName());
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        Data::FilterAction first;
+        first.processId = 1000;
+        Data::FilterAction second;
+        second.processId = 2000;
+        QSignalSpy bottomUpSpy(&parser, &PerfParser::bottomUpDataAvailable);
+
+        // the first filter gets superseded right away, only the results of the second one get published
+        parser.filterResults(first);
+        parser.filterResults(second);
+        waitForFilterJobs();
+        QCOMPARE(bottomUpSpy.count(), 1);
+        QCOMPARE(totalCost(bottomUpSpy), qint64(100));
+
+        // the second filter is cached now and gets published right away, the first one must not overwrite it
+        bottomUpSpy.clear();
+        parser.filterResults(first);
+        parser.filterResults(second);
+        waitForFilterJobs();
+        QCOMPARE(bottomUpSpy.count(), 1);
+        QCOMPARE(totalCost(bottomUpSpy), qint64(100));
+
+        // once it gets requested on its own, the first filter gets published as usual
+        bottomUpSpy.clear();
+        parser.filterResults(first);
+        waitForFilterJobs();
+        QCOMPARE(bottomUpSpy.count(), 1);
+        QCOMPARE(totalCost(bottomUpSpy), qint64(30));
+    }
+
+    void testFilterWhileParsing()
+    {
+        QTemporaryFile streamFile;
+        QVERIFY(streamFile.open());
+        {
+            StreamWriter writer(&streamFile);
+            writeDefinitions(&writer);
+            for (int i = 0; i < 20000; ++i) {
+                writer.sample(1000, 1000, 10 + 2 * i, 0, 0, 10);
+                writer.sample(2000, 2000, 11 + 2 * i, 0, 0, 20);
+            }
+        }
+        QVERIFY(streamFile.flush());
+
+        PerfParser parser;
+        parser.setPartialResultsInterval(1);
+        QSignalSpy parsingFinishedSpy(&parser, &PerfParser::parsingFinished);
+        QSignalSpy bottomUpSpy(&parser, &PerfParser::bottomUpDataAvailable);
+
+        // the filter gets requested while the partial results come in, it gets applied once parsing finished
+        Data::FilterAction filter;
+        filter.processId = 2000;
+        connect(&parser, &PerfParser::partialResultsAvailable, &parser,
+                [&parser, filter]() { parser.filterResults(filter); });
+        parser.startParseFile(streamFile.fileName(), {}, {}, {}, {}, {}, {});
+        parser.filterResults(filter);
+
+        QVERIFY(parsingFinishedSpy.wait(10000));
+        QTRY_COMPARE_WITH_TIMEOUT(totalCost(bottomUpSpy), qint64(20000 * 20), 10000);
+        waitForFilterJobs();
+        QCOMPARE(totalCost(bottomUpSpy), qint64(20000 * 20));
+    }
+
+    void testInterleavedContextSwitches()
+    {
+        QTemporaryFile streamFile;
+        QVERIFY(streamFile.open());
+        {
+            StreamWriter writer(&streamFile);
+            writeDefinitions(&writer);
+            writer.sample(1000, 1000, 10, 0, 0, 10);
+            writer.contextSwitch(1000, 1000, 20, 0, true);
+            // the off-CPU event only gets added on the switch in, after this sample
+            writer.sample(1000, 1000, 30, 0, 0, 10);
+            writer.contextSwitch(1000, 1000, 40, 0, false);
+            writer.sample(1000, 1000, 50, 0, 0, 10);
+            writer.contextSwitch(1000, 1000, 60, 0, true);
+            writer.sample(1000, 1000, 70, 0, 0, 10);
+            writer.sample(1000, 1000, 80, 0, 0, 10);
+            writer.contextSwitch(1000, 1000, 90, 0, false);
+        }
+        QVERIFY(streamFile.flush());
+
+        PerfParser parser;
+        QSignalSpy eventsSpy(&parser, &PerfParser::eventsAvailable);
+        parse(&parser, streamFile.fileName());
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        const auto events = eventsSpy.last().first().value<Data::Snapshot<Data::EventResults>>();
+        QCOMPARE(events->threads.size(), 1);
+        const auto& threadEvents = events->threads.first().events;
+        QVector<quint64> times;
+        for (const auto& event : threadEvents) {
+            times.append(event.time);
+        }
+        QCOMPARE(times, (QVector<quint64>{10, 20, 30, 50, 60, 70, 80}));
+        QCOMPARE(threadEvents.type(1), events->offCpuTimeCostId);
+        QCOMPARE(threadEvents.cost(1), quint64(20));
+        QCOMPARE(threadEvents.type(4), events->offCpuTimeCostId);
+        QCOMPARE(threadEvents.cost(4), quint64(30));
+
+        // the cpus still reference the samples
+        QCOMPARE(events->cpus.size(), 1);
+        QVector<quint64> cpuTimes;
+        for (const auto& index : events->cpus.first().events) {
+            QCOMPARE(index.thread, 0);
+            QCOMPARE(threadEvents.type(index.event), 0);
+            cpuTimes.append(threadEvents.time(index.event));
+        }
+        QCOMPARE(cpuTimes, (QVector<quint64>{10, 30, 50, 70, 80}));
+    }
+
+    void testReusedThreadIds()
+    {
+        QTemporaryFile streamFile;
+        QVERIFY(streamFile.open());
+        {
+            StreamWriter writer(&streamFile);
+            writeDefinitions(&writer);
+            // two processes that reuse the same tid one after the other
+            writer.threadStart(1000, 1000, 10);
+            writer.threadStart(1000, 1005, 11);
+            writer.sample(1000, 1005, 12, 0, 0, 10);
+            writer.threadEnd(1000, 1005, 13);
+            writer.threadEnd(1000, 1000, 14);
+            writer.threadStart(2000, 2000, 20);
+            writer.threadStart(2000, 1005, 21);
+            writer.sample(2000, 1005, 22, 0, 0, 20);
+            writer.threadEnd(2000, 1005, 23);
+            // and a process that reuses both the pid and tid of an earlier one
+            writer.threadStart(1000, 1000, 30);
+            writer.threadStart(1000, 1005, 31);
+            writer.sample(1000, 1005, 32, 0, 0, 30);
+            writer.sample(1000, 1005, 33, 0, 0, 30);
+            writer.threadEnd(1000, 1005, 34);
+        }
+        QVERIFY(streamFile.flush());
+
+        PerfParser parser;
+        QSignalSpy eventsSpy(&parser, &PerfParser::eventsAvailable);
+        parse(&parser, streamFile.fileName());
+        if (QTest::currentTestFailed()) {
+            return;
+        }
+
+        const auto events = eventsSpy.last().first().value<Data::Snapshot<Data::EventResults>>();
+        QVector<QVector<quint64>> threads;
+        for (const auto& thread : events->threads) {
+            if (thread.tid != 1005) {
+                continue;
+            }
+            QVector<quint64> costs;
+            for (const auto& event : thread.events) {
+                costs.append(event.cost);
+            }
+            // each thread keeps its own time span and samples
+            QVERIFY(thread.time.start < thread.time.end);
+            threads.append(costs);
+        }
+        QCOMPARE(threads, (QVector<QVector<quint64>>{{10}, {20}, {30, 30}}));
+    }
+
+private:
+    static void parse(PerfParser* parser, const QString& fileName)
+    {
+        QSignalSpy parsingFinishedSpy(parser, &PerfParser::parsingFinished);
+        QSignalSpy parsingFailedSpy(parser, &PerfParser::parsingFailed);
+        parser->startParseFile(fileName, {}, {}, {}, {}, {}, {});
+        QVERIFY(parsingFinishedSpy.wait(10000));
+        QCOMPARE(parsingFailedSpy.count(), 0);
+        // the parser remembers the results for filtering via a queued call
+        QCoreApplication::processEvents();
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPerfParserStream);
+
+#include "tst_perfparserstream.moc"
@@ -0,0 +1,268 @@
+/*
+  bench_models.cpp
+
+  This file is part of Hotspot, the Qt GUI for performance analysis.
+
+  Copyright (C) 2017-2020 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+
+  Licensees holding valid commercial KDAB Hotspot licenses may use this file in
+  accordance with Hotspot Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <QDebug>
+#include <QFile>
+#include <QObject>
+#include <QTest>
+
+#include <models/data.h>
+#include <models/eventmodel.h>
+
+namespace {
+/**
+ * Generates a bottom up tree by adding random stacks, similar to what the parser does.
+ *
+ * Frames close to the leaves are picked from a small set of symbols, which makes the
+ * stacks share their leaves. Symbols may repeat within a stack, i.e. we get recursion.
+ */
+class TreeGenerator
+{
+public:
+    Data::BottomUpResults generate(quint32 numNodes)
+    {
+        Data::BottomUpResults results;
+        results.costs.addType(0, QStringLiteral("cycles"), Data::Costs::Unit::Unknown);
+        results.costs.addType(1, QStringLiteral("instructions"), Data::Costs::Unit::Unknown);
+
+        const int numSymbols = 50000;
+        results.symbolTable.reserve(numSymbols);
+        for (int i = 0; i < numSymbols; ++i) {
+            results.symbolTable.append({QStringLiteral("func_%1()").arg(i), QStringLiteral("libbench.so")});
+        }
+
+        quint32 maxId = 0;
+        while (maxId < numNodes) {
+            const qint64 cycles = 1 + next() % 1000;
+            const qint64 instructions = 1 + next() % 2000;
+            results.costs.addTotalCost(0, cycles);
+            results.costs.addTotalCost(1, instructions);
+
+            auto* parent = &results.root;
+            const int depth = 5 + next() % 40;
+            for (int i = 0; i < depth && maxId < numNodes; ++i) {
+                const Data::SymbolId symbolId = (next() % (8u << std::min(i, 12))) % numSymbols;
+                parent = parent->entryForSymbol(symbolId, results.symbolTable[symbolId], &maxId);
+                results.costs.add(0, parent->id, cycles);
+                results.costs.add(1, parent->id, instructions);
+            }
+        }
+
+        Data::BottomUp::initializeParents(&results.root);
+        return results;
+    }
+
+private:
+    quint32 next()
+    {
+        m_seed = m_seed * 1664525u + 1013904223u;
+        return m_seed >> 8;
+    }
+
+    quint32 m_seed = 42;
+};
+
+/**
+ * Generates demangled names that look like what libstdc++ produces for code using nested containers and strings.
+ *
+ * Set HOTSPOT_BENCH_SYMBOLS to a file with one symbol per line, e.g. from `nm -C libfoo.so | cut -c 20-`,
+ * to benchmark a real symbol corpus instead.
+ */
+QStringList generateSymbols()
+{
+    const auto path = QString::fromLocal8Bit(qgetenv("HOTSPOT_BENCH_SYMBOLS"));
+    if (!path.isEmpty()) {
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QStringList symbols;
+            while (!file.atEnd()) {
+                const auto line = QString::fromUtf8(file.readLine()).trimmed();
+                if (!line.isEmpty())
+                    symbols.append(line);
+            }
+            return symbols;
+        }
+        qWarning() << "failed to open symbol file" << path << file.errorString();
+    }
+
+    const auto string = QStringLiteral(
+        "std::__cxx11::basic_string<char, std::char_traits<char>, std::allocator<char> >");
+    const auto vector = QStringLiteral("std::vector<%1, std::allocator<%1> >");
+    const auto map = QStringLiteral("std::map<%1, %2, std::less<%1>, std::allocator<std::pair<%1 const, %2> > >");
+
+    QStringList symbols;
+    QStringList types = {QStringLiteral("int"), string};
+    for (int i = 0; i < 4; ++i) {
+        const auto numTypes = types.size();
+        for (int j = 0; j < numTypes; ++j) {
+            types.append(vector.arg(types[j]));
+            types.append(map.arg(string, types[j]));
+        }
+    }
+    for (int i = 0; i < types.size(); ++i) {
+        symbols.append(QStringLiteral("void ns::process_%1(%2 const&)").arg(i).arg(types[i]));
+        symbols.append(QStringLiteral("%1::operator=(%1 const&)").arg(types[i]));
+    }
+    return symbols;
+}
+}
+
+class BenchModels : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase()
+    {
+        // five million nodes by default, can be overridden to quickly check smaller trees
+        const auto numNodes = qEnvironmentVariableIsSet("HOTSPOT_BENCH_NODES")
+            ? quint32(qEnvironmentVariableIntValue("HOTSPOT_BENCH_NODES"))
+            : quint32(5000000);
+        m_bottomUp = TreeGenerator().generate(numNodes);
+        qDebug() << "generated bottom up tree with" << numNodes << "nodes";
+    }
+
+    void benchTopDown()
+    {
+        QBENCHMARK {
+            const auto topDown = Data::TopDownResults::fromBottomUp(m_bottomUp);
+            QVERIFY(!topDown.root.children.isEmpty());
+        }
+    }
+
+    void benchCallerCallee()
+    {
+        QBENCHMARK {
+            Data::CallerCalleeResults callerCallee;
+            Data::callerCalleesFromBottomUpData(m_bottomUp, &callerCallee);
+            QVERIFY(!callerCallee.entries.isEmpty());
+        }
+    }
+
+    void benchPrettifySymbol()
+    {
+        const auto symbols = generateSymbols();
+        QVERIFY(!symbols.isEmpty());
+
+        QBENCHMARK {
+            for (const auto& symbol : symbols)
+                Data::prettifySymbol(symbol);
+        }
+    }
+
+    void benchPrettySymbolCached()
+    {
+        const auto symbols = generateSymbols();
+        QVector<Data::Symbol> dataSymbols;
+        dataSymbols.reserve(symbols.size());
+        for (const auto& symbol : symbols) {
+            dataSymbols.append({symbol, QStringLiteral("libbench.so")});
+            dataSymbols.last().internPrettySymbol();
+        }
+
+        QBENCHMARK {
+            for (const auto& symbol : dataSymbols)
+                symbol.prettySymbol();
+        }
+    }
+
+    void benchEventPyramid()
+    {
+        Data::Events events;
+        const int numEvents = 5000000;
+        events.reserve(numEvents);
+        for (int i = 0; i < numEvents; ++i) {
+            Data::Event event;
+            event.time = quint64(i) * 100 + (i % 7) * 13;
+            event.cost = 1 + (i * 2654435761u) % 100000;
+            event.type = i % 2;
+            events.append(event);
+        }
+
+        const Data::EventPyramid pyramid(events, 2, 1);
+        const auto time = pyramid.timeRange();
+        // paint a timeline row that is 2000 pixels wide, zoomed out completely
+        const int width = 2000;
+        QBENCHMARK {
+            quint32 numFound = 0;
+            for (int x = 0; x < width; ++x) {
+                const Data::TimeRange pixel(time.start + time.delta() * x / width,
+                                            time.start + time.delta() * (x + 1) / width);
+                numFound += pyramid.query(0, pixel).numEvents;
+                pyramid.offCpuIntervals().blockedTime(pixel);
+            }
+            QCOMPARE(numFound, quint32(numEvents / 2));
+        }
+    }
+
+    void benchEventModel()
+    {
+        // a thread pool heavy service with many short-lived threads
+        Data::EventResults results;
+        results.totalCosts = {{QStringLiteral("cycles"), 0, 0, Data::Costs::Unit::Unknown}};
+        const int numProcesses = 100;
+        const int numThreads = 100000;
+        results.threads.resize(numThreads);
+        for (int i = 0; i < numThreads; ++i) {
+            auto& thread = results.threads[i];
+            thread.pid = 1000 + (i * 7) % numProcesses;
+            thread.tid = i < numProcesses ? thread.pid : 1000 + i;
+            thread.time = {quint64(i) * 10, quint64(i) * 10 + 1000};
+            thread.name = QStringLiteral("worker");
+            for (quint64 time = thread.time.start; time < thread.time.end; time += 100) {
+                Data::Event event;
+                event.time = time;
+                event.cost = 1;
+                thread.events.append(event);
+            }
+        }
+        const auto data = Data::makeSnapshot(results);
+
+        EventModel model;
+        QBENCHMARK {
+            model.setData(data);
+            const auto processes = model.index(1, EventModel::ThreadColumn);
+            QCOMPARE(model.rowCount(processes), numProcesses);
+            int rows = 0;
+            for (int i = 0; i < numProcesses; ++i) {
+                const auto process = model.index(i, EventModel::ThreadColumn, processes);
+                QVERIFY(!process.data(Qt::ToolTipRole).toString().isEmpty());
+                for (int j = 0, c = model.rowCount(process); j < c; ++j) {
+                    const auto thread = model.index(j, EventModel::ThreadColumn, process);
+                    thread.data(EventModel::SortRole);
+                    ++rows;
+                }
+            }
+            QCOMPARE(rows, numThreads);
+        }
+    }
+
+private:
+    Data::BottomUpResults m_bottomUp;
+};
+
+QTEST_GUILESS_MAIN(BenchModels);
+
+#include "bench_models.moc"
@@ -99,6 +99,40 @@ private slots:
         }
     }
 
+    void testInternedSymbols()
+    {
+        Data::BottomUpResults results;
+        results.costs.addType(0, "samples", Data::Costs::Unit::Unknown);
+        results.symbolTable = {{"A", "lib.so"}, {"B", "lib.so"}};
+        // two different locations of A share the same symbol id
+        results.symbols = {results.symbolTable[0], results.symbolTable[1], results.symbolTable[0]};
+        results.symbolIds = {0, 1, 0};
+        results.locations = {{-1, {0x10}}, {-1, {0x20}}, {-1, {0x30}}};
+
+        QVector<Data::SymbolId> visitedIds;
+        auto frameCallback = [&visitedIds](Data::SymbolId symbolId, const Data::Location& /*location*/) {
+            visitedIds.append(symbolId);
+        };
+        Data::FlatBottomUp partial;
+        partial.costs.addType(0, "samples", Data::Costs::Unit::Unknown);
+        results.addEvent(&partial, 0, 1, {0, 1}, frameCallback);
+        results.addEvent(&partial, 0, 1, {2, 1}, frameCallback);
+        QCOMPARE(visitedIds, (QVector<Data::SymbolId>{0, 1, 0, 1}));
+        // both stacks share the same nodes in the partial tree already
+        QCOMPARE(partial.nodes.size(), 3);
+
+        results.merge(partial);
+        QCOMPARE(results.costs.totalCost(0), qint64(2));
+
+        QCOMPARE(results.root.children.size(), 1);
+        const auto& a = results.root.children.first();
+        QCOMPARE(a.symbol, results.symbolTable[0]);
+        QCOMPARE(a.symbolId, 0);
+        QCOMPARE(results.costs.cost(0, a.id), qint64(2));
+        QCOMPARE(a.children.size(), 1);
+        QCOMPARE(a.children.first().symbolId, 1);
+    }
+
     void testBottomUpModel()
     {
         const auto tree = generateTree1();
@@ -315,6 +349,537 @@ private slots:
         }
     }
 
+    void testMergePartialResults()
+    {
+        const auto tree = generateTree1();
+        const auto topDown = Data::TopDownResults::fromBottomUp(tree);
+        Data::CallerCalleeResults callerCallee;
+        Data::callerCalleesFromBottomUpData(tree, &callerCallee);
+
+        // one partial result per subtree of the bottom up root, merged in order
+        Data::TopDownResults mergedTopDown;
+        mergedTopDown.selfCosts.initializeCostsFrom(tree.costs);
+        mergedTopDown.inclusiveCosts.initializeCostsFrom(tree.costs);
+        Data::CallerCalleeResults mergedCallerCallee;
+        mergedCallerCallee.selfCosts.initializeCostsFrom(tree.costs);
+        mergedCallerCallee.inclusiveCosts.initializeCostsFrom(tree.costs);
+        for (int i = 0, c = tree.root.children.size(); i < c; ++i) {
+            mergedTopDown.merge(Data::TopDownResults::fromBottomUp(tree, i, i + 1));
+
+            Data::CallerCalleeResults partial;
+            Data::callerCalleesFromBottomUpData(tree, &partial, i, i + 1);
+            mergedCallerCallee.merge(partial);
+        }
+        Data::TopDown::initializeParents(&mergedTopDown.root);
+
+        QCOMPARE(printTree(mergedTopDown), printTree(topDown));
+        QCOMPARE(printMap(mergedCallerCallee), printMap(callerCallee));
+        for (const auto& entry : mergedCallerCallee.entries) {
+            QVERIFY(entry.id < static_cast<quint32>(mergedCallerCallee.entries.size()));
+        }
+    }
+
+    void testCosts()
+    {
+        Data::Costs costs;
+        costs.addType(0, "cycles", Data::Costs::Unit::Unknown);
+        costs.add(0, 3, 10);
+        costs.add(0, 1, 5);
+        QCOMPARE(costs.cost(0, 3), qint64(10));
+        QCOMPARE(costs.cost(0, 1), qint64(5));
+        QCOMPARE(costs.cost(0, 2), qint64(0));
+        QCOMPARE(costs.cost(0, 100), qint64(0));
+        QVERIFY(!costs.row(100));
+
+        // adding a type later on keeps the existing costs
+        costs.addType(1, "off-CPU Time", Data::Costs::Unit::Time);
+        QCOMPARE(costs.cost(0, 3), qint64(10));
+        QCOMPARE(costs.cost(1, 3), qint64(0));
+        costs.add(1, 3, 7);
+
+        const auto itemCost = costs.itemCost(3);
+        QCOMPARE(itemCost.size(), size_t(2));
+        QCOMPARE(itemCost[0], qint64(10));
+        QCOMPARE(itemCost[1], qint64(7));
+
+        costs.add(1, itemCost);
+        QCOMPARE(costs.cost(0, 1), qint64(15));
+        QCOMPARE(costs.cost(1, 1), qint64(7));
+        const auto row = costs.row(1);
+        QVERIFY(row);
+        QCOMPARE(row[0], qint64(15));
+        QCOMPARE(row[1], qint64(7));
+    }
+
+    void testWideSymbolTree()
+    {
+        Data::BottomUp root;
+        quint32 maxId = 0;
+        const int numChildren = 100;
+        for (int round = 0; round < 2; ++round) {
+            // add in reverse order, the children must keep the order in which they were first added
+            for (Data::SymbolId symbolId = numChildren - 1; symbolId >= 0; --symbolId) {
+                const Data::Symbol symbol(QString::number(symbolId));
+                auto child = root.entryForSymbol(symbolId, symbol, &maxId);
+                QCOMPARE(child->symbolId, symbolId);
+                QCOMPARE(child->symbol, symbol);
+            }
+        }
+
+        QCOMPARE(root.children.size(), numChildren);
+        QCOMPARE(maxId, quint32(numChildren));
+        for (int i = 0; i < numChildren; ++i) {
+            QCOMPARE(root.children[i].symbolId, numChildren - 1 - i);
+            QCOMPARE(root.children[i].id, quint32(i));
+        }
+
+        // copies share the child index until they diverge
+        auto copy = root;
+        const Data::Symbol extraSymbol(QStringLiteral("extra"));
+        QCOMPARE(copy.entryForSymbol(numChildren, extraSymbol, &maxId)->id, quint32(numChildren));
+        QCOMPARE(copy.entryForSymbol(numChildren, extraSymbol, &maxId)->id, quint32(numChildren));
+        QCOMPARE(copy.children.size(), numChildren + 1);
+        QCOMPARE(root.entryForSymbol(0, Data::Symbol(QStringLiteral("0")), &maxId)->id, quint32(numChildren - 1));
+        QCOMPARE(root.children.size(), numChildren);
+
+        // reordering the children requires to invalidate the index
+        std::reverse(root.children.begin(), root.children.end());
+        root.invalidateChildIndex();
+        for (Data::SymbolId symbolId = 0; symbolId < numChildren; ++symbolId) {
+            auto child = root.entryForSymbol(symbolId, Data::Symbol(QString::number(symbolId)), &maxId);
+            QCOMPARE(child, &root.children[symbolId]);
+        }
+        QCOMPARE(root.children.size(), numChildren);
+    }
+
+    void testFlatBottomUp()
+    {
+        Data::FlatBottomUp tree;
+        const auto a = tree.child(0, 5);
+        const auto b = tree.child(0, 3);
+        const auto aa = tree.child(a, 3);
+        QCOMPARE(tree.child(0, 5), a);
+        QCOMPARE(tree.child(a, 3), aa);
+        QCOMPARE(tree.nodes.size(), 4);
+
+        // children keep their insertion order
+        QCOMPARE(tree.nodes[0].firstChild, a);
+        QCOMPARE(tree.nodes[a].nextSibling, b);
+        QCOMPARE(tree.nodes[b].nextSibling, -1);
+        QCOMPARE(tree.nodes[aa].parent, a);
+        QCOMPARE(tree.nodes[aa].symbolId, 3);
+
+        // wide nodes get indexed, which must not change the results
+        QVector<qint32> children;
+        for (Data::SymbolId symbolId = 0; symbolId < 100; ++symbolId) {
+            children.append(tree.child(b, symbolId));
+        }
+        for (Data::SymbolId symbolId = 0; symbolId < 100; ++symbolId) {
+            QCOMPARE(tree.child(b, symbolId), children[symbolId]);
+        }
+        QCOMPARE(tree.nodes[b].numChildren, 100);
+        QCOMPARE(tree.nodes[b].firstChild, children.first());
+        QCOMPARE(tree.nodes[b].lastChild, children.last());
+    }
+
+    void testFindEventsInTimeRange()
+    {
+        Data::Events events;
+        for (quint64 time : {10, 20, 20, 30, 40}) {
+            Data::Event event;
+            event.time = time;
+            events.append(event);
+        }
+
+        auto range = Data::findEventsInTimeRange(events, {20, 30});
+        QCOMPARE(int(std::distance(events.cbegin(), range.first)), 1);
+        QCOMPARE(int(std::distance(range.first, range.second)), 3);
+
+        range = Data::findEventsInTimeRange(events, {21, 29});
+        QCOMPARE(range.first, range.second);
+
+        range = Data::findEventsInTimeRange(events, {0, 100});
+        QCOMPARE(range.first, events.cbegin());
+        QCOMPARE(range.second, events.cend());
+    }
+
+    void testColumnarEvents()
+    {
+        QVector<Data::Event> expected;
+        quint64 time = 1000;
+        for (int i = 0; i < 1000; ++i) {
+            Data::Event event;
+            // include some gaps that don't fit into the delta encoding and some huge costs
+            time += (i % 300 == 299) ? (quint64(1) << 40) : 10;
+            event.time = time;
+            event.cost = (i % 100 == 99) ? (quint64(1) << 36) : quint64(i);
+            // as well as types and cpu ids that don't fit into the narrow columns
+            event.type = (i % 150 == 149) ? (i % 2 ? 100000 : -100000) : (i % 3);
+            event.stackId = i % 7 ? i : -1;
+            if (i % 5 == 0)
+                event.cpuId = Data::INVALID_CPU_ID;
+            else if (i % 111 == 110)
+                event.cpuId = 65534 + i % 3;
+            else
+                event.cpuId = quint32(i % 4);
+            expected.append(event);
+        }
+
+        Data::Events events;
+        for (const auto& event : expected) {
+            events.append(event);
+        }
+
+        QCOMPARE(events.size(), expected.size());
+        for (int i = 0; i < expected.size(); ++i) {
+            QVERIFY(events.at(i) == expected.at(i));
+            QCOMPARE(events.time(i), expected.at(i).time);
+            QCOMPARE(events.cost(i), expected.at(i).cost);
+            QCOMPARE(events.type(i), expected.at(i).type);
+            QCOMPARE(events.cpuId(i), expected.at(i).cpuId);
+        }
+        QVERIFY(std::equal(events.begin(), events.end(), expected.begin()));
+
+        const auto mid = events.mid(250, 500);
+        QCOMPARE(mid.size(), 500);
+        QVERIFY(mid.first() == expected.at(250));
+        QVERIFY(mid.last() == expected.at(749));
+        QVERIFY(mid != events);
+        QCOMPARE(events.mid(0), events);
+
+        // inserting re-encodes the events after it, also when the inserted one needs the wide encoding
+        auto expectedInserted = expected;
+        auto inserted = events;
+        for (int pos : {999, 600, 0}) {
+            auto event = expected.at(pos);
+            event.time -= 5;
+            event.cost = quint64(1) << 36;
+            expectedInserted.insert(pos, event);
+            inserted.insert(pos, event);
+        }
+        QCOMPARE(inserted.size(), expectedInserted.size());
+        QVERIFY(std::equal(inserted.begin(), inserted.end(), expectedInserted.begin()));
+
+        // truncating drops the wide entries too, such that appending again works
+        for (int size : {700, 600, 512, 1}) {
+            auto truncated = events;
+            truncated.truncate(size);
+            QCOMPARE(truncated, events.mid(0, size));
+            for (int i = size; i < expected.size(); ++i) {
+                truncated.append(expected.at(i));
+            }
+            QCOMPARE(truncated, events);
+        }
+
+        // dropping leading events only drops whole blocks, which keeps the other events as they are
+        auto trimmed = events;
+        QCOMPARE(trimmed.removeLeading(200), 0);
+        QCOMPARE(trimmed, events);
+        QCOMPARE(trimmed.removeLeading(600), 512);
+        QCOMPARE(trimmed, events.mid(512));
+        trimmed.append(expected.last());
+        QCOMPARE(trimmed.last(), expected.last());
+        QCOMPARE(trimmed.removeLeading(trimmed.size()), 256);
+        QCOMPARE(trimmed.size(), expected.size() - 768 + 1);
+
+        QVERIFY(events.memoryUsage() < qint64(expected.size() * sizeof(Data::Event)));
+    }
+
+    void testEventsView()
+    {
+        Data::EventResults results;
+        results.threads.resize(2);
+        for (quint64 time : {10, 30, 50}) {
+            Data::Event event;
+            event.time = time;
+            event.cost = time;
+            event.type = 0;
+            results.threads[0].events.append(event);
+            event.time += 10;
+            event.cost += 10;
+            event.type = 1;
+            results.threads[1].events.append(event);
+        }
+        Data::CpuEvents cpu;
+        cpu.cpuId = 0;
+        cpu.events = {{0, 0}, {1, 0}, {0, 1}, {1, 1}, {1, 2}};
+
+        const Data::EventsView view(results.threads, cpu.events);
+        QCOMPARE(view.size(), 5);
+        QCOMPARE(view.time(1), quint64(20));
+        QCOMPARE(view.cost(3), quint64(40));
+        QCOMPARE(view.type(4), 1);
+        QCOMPARE(view.lowerBound(0), 0);
+        QCOMPARE(view.lowerBound(30), 2);
+        QCOMPARE(view.lowerBound(31), 3);
+        QCOMPARE(view.lowerBound(100), 5);
+        QCOMPARE(view, Data::EventsView(results.eventsForCpu(cpu)));
+        QVERIFY(view != Data::EventsView(results.threads[0].events));
+
+        const Data::EventsView threadView(results.threads[1].events);
+        QCOMPARE(threadView.size(), 3);
+        QVERIFY(threadView.at(0) == results.threads[1].events.at(0));
+        QCOMPARE(threadView.lowerBound(40), 1);
+    }
+
+    void testEventPyramid()
+    {
+        const qint32 offCpuCostId = 2;
+        Data::Events events;
+        quint64 time = 1000;
+        for (int i = 0; i < 5000; ++i) {
+            Data::Event event;
+            // bursts of events at the same time and some larger gaps in between
+            time += (i % 7 == 0) ? 0 : ((i % 97 == 0) ? 5000 : 10 + i % 13);
+            event.time = time;
+            event.type = i % 3;
+            event.cost = event.type == offCpuCostId ? (i % 11) * 20 : quint64(1 + i % 1000);
+            events.append(event);
+        }
+
+        const Data::EventPyramid pyramid(events, 3, offCpuCostId);
+        QVERIFY(pyramid.numLevels() > 1);
+        QCOMPARE(pyramid.timeRange().start, events.first().time);
+        QVERIFY(pyramid.timeRange().end > events.last().time);
+
+        auto bruteForce = [&events](qint32 type, Data::TimeRange range) {
+            Data::EventPyramid::Bucket ret;
+            for (const auto& event : events) {
+                if (event.type == type && event.time >= range.start && event.time < range.end)
+                    ret.add(event.cost);
+            }
+            return ret;
+        };
+
+        quint64 seed = 1;
+        auto next = [&seed](quint64 max) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            return (seed >> 33) % max;
+        };
+        const auto maxTime = pyramid.timeRange().end + 1000;
+        for (int i = 0; i < 1000; ++i) {
+            const auto start = next(maxTime);
+            const auto end = start + next(i % 2 ? 100 : maxTime);
+            for (qint32 type = 0; type < 3; ++type) {
+                const Data::TimeRange range(start, end);
+                QCOMPARE(pyramid.query(type, range), bruteForce(type, range));
+            }
+        }
+        QCOMPARE(pyramid.query(0, Data::MAX_TIME_RANGE), bruteForce(0, Data::MAX_TIME_RANGE));
+        QCOMPARE(pyramid.query(3, Data::MAX_TIME_RANGE), Data::EventPyramid::Bucket());
+
+        const auto numOffCpuPeriods = std::count_if(events.begin(), events.end(), [](const Data::Event& event) {
+            return event.type == offCpuCostId && event.cost > 0;
+        });
+        QCOMPARE(pyramid.offCpuIntervals().size(), int(numOffCpuPeriods));
+
+        const Data::EventPyramid empty({}, 3, offCpuCostId);
+        QCOMPARE(empty.query(0, Data::MAX_TIME_RANGE), Data::EventPyramid::Bucket());
+        QVERIFY(empty.offCpuIntervals().isEmpty());
+    }
+
+    void testOffCpuIntervals()
+    {
+        const qint32 offCpuCostId = 1;
+        Data::Events events;
+        auto addEvent = [&events](quint64 time, quint64 cost, qint32 type) {
+            Data::Event event;
+            event.time = time;
+            event.cost = cost;
+            event.type = type;
+            events.append(event);
+        };
+        // some samples and sched switches, the latter two overlap like they can on a CPU
+        addEvent(100, 5, 0);
+        addEvent(110, 20, offCpuCostId);
+        addEvent(150, 5, 0);
+        addEvent(160, 0, offCpuCostId);
+        addEvent(200, 100, offCpuCostId);
+        addEvent(250, 10, offCpuCostId);
+
+        const Data::OffCpuIntervals intervals(events, offCpuCostId);
+        QCOMPARE(intervals.size(), 3);
+        QCOMPARE(intervals.at(0), Data::TimeRange(110, 130));
+        QCOMPARE(intervals.at(1), Data::TimeRange(200, 300));
+        QCOMPARE(intervals.at(2), Data::TimeRange(250, 260));
+
+        QCOMPARE(intervals.find({0, 110}), -1);
+        QCOMPARE(intervals.find({110, 111}), 0);
+        QCOMPARE(intervals.find({129, 130}), 0);
+        QCOMPARE(intervals.find({130, 200}), -1);
+        QCOMPARE(intervals.find({0, 1000}), 2);
+        QCOMPARE(intervals.find({255, 256}), 2);
+        QCOMPARE(intervals.find({270, 271}), 1);
+        QCOMPARE(intervals.find({300, 1000}), -1);
+
+        QCOMPARE(intervals.blockedTime(Data::MAX_TIME_RANGE), quint64(130));
+        QCOMPARE(intervals.blockedTime({0, 120}), quint64(10));
+        QCOMPARE(intervals.blockedTime({120, 120}), quint64(0));
+        QCOMPARE(intervals.blockedTime({120, 255}), quint64(10 + 55 + 5));
+        QCOMPARE(intervals.blockedTime({255, 1000}), quint64(45 + 5));
+
+        // compare against a brute force implementation for random ranges
+        Data::Events manyEvents;
+        quint64 time = 0;
+        quint64 seed = 1;
+        auto next = [&seed](quint64 max) {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            return (seed >> 33) % max;
+        };
+        for (int i = 0; i < 2000; ++i) {
+            time += next(50);
+            Data::Event event;
+            event.time = time;
+            event.type = next(2);
+            event.cost = next(event.type == offCpuCostId ? 200 : 10);
+            manyEvents.append(event);
+        }
+        const Data::OffCpuIntervals manyIntervals(manyEvents, offCpuCostId);
+        for (int i = 0; i < 1000; ++i) {
+            const auto start = next(time + 500);
+            const auto end = start + next(i % 2 ? 50 : time);
+            quint64 expected = 0;
+            for (const auto& event : manyEvents) {
+                if (event.type != offCpuCostId)
+                    continue;
+                const auto overlapStart = std::max(event.time, start);
+                const auto overlapEnd = std::min(event.time + event.cost, end);
+                if (overlapStart < overlapEnd)
+                    expected += overlapEnd - overlapStart;
+            }
+            QCOMPARE(manyIntervals.blockedTime({start, end}), expected);
+        }
+
+        // the events of a single thread don't overlap, which allows looking only at those near the range
+        Data::Events threadEvents;
+        time = 0;
+        for (int i = 0; i < 2000; ++i) {
+            Data::Event event;
+            event.time = time;
+            event.type = next(2);
+            event.cost = next(event.type == offCpuCostId ? 200 : 10);
+            threadEvents.append(event);
+            time += next(50) + (event.type == offCpuCostId ? event.cost : 0);
+        }
+        const Data::OffCpuIntervals threadIntervals(threadEvents, offCpuCostId);
+        QCOMPARE(Data::blockedTimeInRange(threadEvents, -1, Data::MAX_TIME_RANGE), quint64(0));
+        for (int i = 0; i < 1000; ++i) {
+            const auto start = next(time + 500);
+            const auto end = start + next(i % 2 ? 50 : time);
+            QCOMPARE(Data::blockedTimeInRange(threadEvents, offCpuCostId, {start, end}),
+                     threadIntervals.blockedTime({start, end}));
+        }
+    }
+
+    void testThreadIndex()
+    {
+        Data::ThreadIndex index;
+        QCOMPARE(index.find(1, 1), -1);
+        QCOMPARE(index.find(1, 1, 0), -1);
+
+        index.insert(1, 1, 0, 0);
+        index.insert(1, 2, 0, 1);
+        index.insert(2, 1, 0, 2);
+        // negative ids must not collide with other threads
+        index.insert(-1, -1, 0, 3);
+        QCOMPARE(index.size(), 4);
+        QCOMPARE(index.find(1, 1), 0);
+        QCOMPARE(index.find(1, 2), 1);
+        QCOMPARE(index.find(2, 1), 2);
+        QCOMPARE(index.find(-1, -1), 3);
+        QCOMPARE(index.find(2, 2), -1);
+        QCOMPARE(index.find(-1, 1), -1);
+
+        // a reused tid resolves to the newer thread, like EventResults::findThread
+        Data::EventResults results;
+        const QVector<QPair<qint32, qint32>> ids = {{1, 1}, {1, 2}, {2, 1}, {-1, -1}, {1, 2}};
+        for (const auto& id : ids) {
+            Data::ThreadEvents thread;
+            thread.pid = id.first;
+            thread.tid = id.second;
+            results.threads.append(thread);
+        }
+        index.insert(1, 2, 100, 4);
+        QCOMPARE(index.size(), 4);
+        QCOMPARE(index.find(1, 2), 4);
+        for (const auto& thread : results.threads) {
+            QCOMPARE(&results.threads[index.find(thread.pid, thread.tid)], results.findThread(thread.pid, thread.tid));
+        }
+
+        // but only from its start on, earlier events still belong to the thread that ended
+        QCOMPARE(index.find(1, 2, 99), 1);
+        QCOMPARE(index.find(1, 2, 100), 4);
+        QCOMPARE(index.find(1, 2, 1000), 4);
+        index.insert(1, 2, 200, 5);
+        QCOMPARE(index.find(1, 2, 0), 1);
+        QCOMPARE(index.find(1, 2, 150), 4);
+        QCOMPARE(index.find(1, 2, 200), 5);
+        // the other threads are not affected by that
+        QCOMPARE(index.find(1, 1, 150), 0);
+        QCOMPARE(index.find(2, 1, 150), 2);
+
+        // events before the first start still resolve to the first thread
+        index.insert(3, 3, 50, 6);
+        QCOMPARE(index.find(3, 3, 0), 6);
+
+        index.clear();
+        QCOMPARE(index.size(), 0);
+        QCOMPARE(index.find(1, 2), -1);
+        QCOMPARE(index.find(1, 2, 150), -1);
+    }
+
+    void testStackFrames()
+    {
+        Data::EventResults events;
+        // root, then the stacks {2, 1} and {3, 1} sharing the outermost frame
+        events.stacks = {{}, {0, 1}, {1, 2}, {1, 3}};
+
+        QCOMPARE(events.stackFrames(0), QVector<qint32>());
+        QCOMPARE(events.stackFrames(1), QVector<qint32>({1}));
+        QCOMPARE(events.stackFrames(2), QVector<qint32>({2, 1}));
+        QCOMPARE(events.stackFrames(3), QVector<qint32>({3, 1}));
+    }
+
+    void testFilterRefinement()
+    {
+        Data::FilterAction base;
+        base.time = {10, 100};
+        base.excludeThreadIds = {1};
+
+        auto filter = base;
+        QVERIFY(filter.isRefinementOf(base));
+
+        filter.time = {20, 50};
+        filter.excludeThreadIds.append(2);
+        filter.processId = 42;
+        filter.includeSymbols.insert({"foo", "libfoo.so"});
+        QVERIFY(filter.isRefinementOf(base));
+        QVERIFY(!base.isRefinementOf(filter));
+
+        filter.time = {5, 50};
+        QVERIFY(!filter.isRefinementOf(base));
+
+        filter.time = base.time;
+        filter.excludeThreadIds = {2};
+        QVERIFY(!filter.isRefinementOf(base));
+    }
+
+    void testFilterActionHash()
+    {
+        Data::FilterAction lhs;
+        lhs.time = {10, 100};
+        lhs.excludeThreadIds = {1, 2, 3};
+        lhs.excludeSymbols.insert({"foo", "libfoo.so"});
+
+        auto rhs = lhs;
+        rhs.excludeThreadIds = {3, 1, 2, 1};
+        QCOMPARE(lhs, rhs);
+        QCOMPARE(qHash(lhs), qHash(rhs));
+
+        rhs.excludeThreadIds.append(4);
+        QVERIFY(lhs != rhs);
+    }
+
     void testEventModel()
     {
         Data::EventResults events;
@@ -358,7 +923,8 @@ private slots:
         }
 
         Data::CostSummary costSummary("cycles", 0, 0, Data::Costs::Unit::Unknown);
-        auto generateEvent = [&costSummary, &events](quint64 time, quint32 cpuId) -> Data::Event {
+        QVector<Data::Events> cpuEvents(events.cpus.size());
+        auto generateEvent = [&costSummary, &events, &cpuEvents](qint32 threadIndex, quint64 time, quint32 cpuId) {
             Data::Event event;
             event.cost = 10;
             event.cpuId = cpuId;
@@ -366,13 +932,15 @@ private slots:
             event.time = time;
             ++costSummary.sampleCount;
             costSummary.totalPeriod += event.cost;
-            events.cpus[cpuId].events << event;
-            return event;
+            auto& threadEvents = events.threads[threadIndex].events;
+            events.cpus[cpuId].events.append({threadIndex, threadEvents.size()});
+            cpuEvents[cpuId] << event;
+            threadEvents << event;
         };
         for (quint64 time = 0; time < endTime; time += deltaTime) {
-            thread1.events << generateEvent(time, 0);
+            generateEvent(0, time, 0);
             if (thread2.time.contains(time)) {
-                thread2.events << generateEvent(time, 2);
+                generateEvent(1, time, 2);
             }
         }
         events.totalCosts = {costSummary};
@@ -386,10 +954,13 @@ private slots:
 
         auto simplifiedEvents = events;
         simplifiedEvents.cpus.remove(1);
+        cpuEvents.remove(1);
 
         auto verifyCommonData = [&](const QModelIndex& idx) {
-            const auto eventResults = idx.data(EventModel::EventResultsRole).value<Data::EventResults>();
-            QCOMPARE(eventResults, simplifiedEvents);
+            // the model shares the results, the empty cpus are only hidden
+            const auto eventResults =
+                idx.data(EventModel::EventResultsRole).value<Data::Snapshot<Data::EventResults>>();
+            QCOMPARE(*eventResults, events);
             const auto maxTime = idx.data(EventModel::MaxTimeRole).value<quint64>();
             QCOMPARE(maxTime, endTime);
             const auto minTime = idx.data(EventModel::MinTimeRole).value<quint64>();
@@ -402,6 +973,8 @@ private slots:
             QCOMPARE(numCpus, nonEmptyCpus);
             const auto maxCost = idx.data(EventModel::MaxCostRole).value<quint64>();
             QCOMPARE(maxCost, quint64(10));
+            const auto maxCosts = idx.data(EventModel::MaxCostsRole).value<QVector<quint64>>();
+            QCOMPARE(maxCosts, QVector<quint64>({10}));
             const auto totalCost = idx.data(EventModel::TotalCostsRole).value<QVector<Data::CostSummary>>();
             QCOMPARE(totalCost, events.totalCosts);
         };
@@ -429,6 +1002,10 @@ private slots:
                 verifyCommonData(idx);
                 QVERIFY(!model.rowCount(idx));
                 const auto rowEvents = idx.data(EventModel::EventsRole).value<Data::Events>();
+                const auto rowPyramid = idx.data(EventModel::EventPyramidRole).value<Data::EventPyramid>();
+                QCOMPARE(rowPyramid.events(), Data::EventsView(rowEvents));
+                QCOMPARE(rowPyramid.query(0, Data::MAX_TIME_RANGE).numEvents, quint32(rowEvents.size()));
+                QCOMPARE(rowPyramid.query(0, Data::MAX_TIME_RANGE).totalCost, quint64(rowEvents.size() * 10));
                 const auto threadStart = idx.data(EventModel::ThreadStartRole).value<quint64>();
                 const auto threadEnd = idx.data(EventModel::ThreadEndRole).value<quint64>();
                 const auto threadName = idx.data(EventModel::ThreadNameRole).value<QString>();
@@ -438,7 +1015,8 @@ private slots:
 
                 if (isCpuIndex) {
                     const auto& cpu = simplifiedEvents.cpus[j];
-                    QCOMPARE(rowEvents, cpu.events);
+                    QCOMPARE(rowEvents, cpuEvents[j]);
+                    QCOMPARE(simplifiedEvents.eventsForCpu(cpu), cpuEvents[j]);
                     QCOMPARE(threadStart, quint64(0));
                     QCOMPARE(threadEnd, endTime);
                     QCOMPARE(threadId, Data::INVALID_TID);
@@ -464,6 +1042,53 @@ private slots:
         }
     }
 
+    void testEventModelTidReuse()
+    {
+        Data::EventResults events;
+        events.totalCosts = {{"cycles", 0, 0, Data::Costs::Unit::Unknown}};
+        // the process got forked with the same pid and got the same tid for a second worker thread
+        events.threads.resize(4);
+        const qint32 pids[] = {200, 100, 100, 100};
+        const qint32 tids[] = {200, 101, 100, 101};
+        for (int i = 0; i < events.threads.size(); ++i) {
+            auto& thread = events.threads[i];
+            thread.pid = pids[i];
+            thread.tid = tids[i];
+            thread.time = {quint64(i) * 100, quint64(i) * 100 + 50};
+            thread.name = QStringLiteral("thread%1").arg(i);
+            for (int j = 0; j <= i; ++j) {
+                Data::Event event;
+                event.time = thread.time.start + j;
+                event.cost = 10;
+                thread.events.append(event);
+            }
+        }
+
+        EventModel model;
+        ModelTest tester(&model);
+        model.setData(events);
+
+        const auto processes = model.index(1, EventModel::ThreadColumn);
+        QCOMPARE(model.rowCount(processes), 2);
+
+        // processes are sorted by pid, their threads are kept in the order they got encountered
+        const auto process = model.index(0, EventModel::ThreadColumn, processes);
+        QCOMPARE(process.data(EventModel::SortRole).value<qint32>(), 100);
+        // the name of the main thread is preferred
+        QCOMPARE(process.data().toString(), QStringLiteral("thread2 (#100)"));
+        QVERIFY(process.data(Qt::ToolTipRole).toString().contains(QLatin1String("Number of Events: 9")));
+        QCOMPARE(model.rowCount(process), 3);
+        for (int i = 0; i < 3; ++i) {
+            const auto idx = model.index(i, EventModel::ThreadColumn, process);
+            const auto& thread = events.threads[i + 1];
+            QCOMPARE(idx.data(EventModel::ThreadIdRole).value<qint32>(), thread.tid);
+            QCOMPARE(idx.data(EventModel::ThreadStartRole).value<quint64>(), thread.time.start);
+            QCOMPARE(idx.data(EventModel::EventsRole).value<Data::Events>(), thread.events);
+            const auto pyramid = idx.data(EventModel::EventPyramidRole).value<Data::EventPyramid>();
+            QCOMPARE(pyramid.query(0, Data::MAX_TIME_RANGE).numEvents, quint32(thread.events.size()));
+        }
+    }
+
     void testPrettySymbol_data()
     {
         QTest::addColumn<QString>("prettySymbol");
@@ -567,6 +1192,23 @@ private slots:
         QTest::newRow("unordered_multimap") << "std::unordered_multimap<int, float>"
                                             << "std::unordered_multimap<int, float, std::hash<int>, std::equal_to<int>,"
                                                " std::allocator<std::pair<int const, float> > >";
+        // commas within nested brackets don't end the template argument
+        QTest::newRow("function type argument")
+            << "std::vector<std::function<void (int, int)>>"
+            << "std::vector<std::function<void (int, int)>, std::allocator<std::function<void (int, int)> > >";
+        QTest::newRow("nested template argument")
+            << "std::map<std::pair<int, int>, float>"
+            << "std::map<std::pair<int, int>, float, std::less<std::pair<int, int> >,"
+               " std::allocator<std::pair<std::pair<int, int> const, float> > >";
+        QTest::newRow("array argument") << "std::vector<std::array<int, 3ul>>"
+                                        << "std::vector<std::array<int, 3ul>, std::allocator<std::array<int, 3ul> > >";
+        // std types directly after a comma get prettified too
+        QTest::newRow("function arguments without space")
+            << "bar(std::vector<int>,std::vector<char>)"
+            << "bar(std::vector<int, std::allocator<int> >,std::vector<char, std::allocator<char> >)";
+        QTest::newRow("template arguments without space")
+            << "foo<int,std::vector<int> >(int)"
+            << "foo<int,std::vector<int, std::allocator<int> > >(int)";
         QTest::newRow("bound function")
             << "std::__function::__func<std::__bind<bool (foobar::map::api_v2::DeltaAccessImpl::*)"
                "(std::string const&, std::string const&, std::string const&,"
@@ -617,7 +1259,16 @@ private slots:
         QFETCH(QString, prettySymbol);
         QFETCH(QString, symbol);
 
-        QCOMPARE(Data::Symbol(symbol).prettySymbol, prettySymbol);
+        QCOMPARE(Data::Symbol(symbol).prettySymbol(), prettySymbol);
+
+        // interned symbols remember the result, which doesn't affect comparisons
+        Data::Symbol interned(symbol);
+        interned.internPrettySymbol();
+        const auto copy = interned;
+        QCOMPARE(copy.pretty, prettySymbol);
+        QCOMPARE(copy.prettySymbol(), prettySymbol);
+        QCOMPARE(copy, Data::Symbol(symbol));
+        QCOMPARE(qHash(copy), qHash(Data::Symbol(symbol)));
     }
 };
 